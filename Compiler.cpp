@@ -0,0 +1,680 @@
+#include "./headers/Compiler.hpp"
+#include "./headers/Errors.hpp"
+#include "./headers/LoxString.hpp"
+
+#include <cstring>
+
+Ref<VMFunction> Compiler::compile(const std::vector<Stmt*>& statements)
+{
+    FunctionState script {nullptr, makeObject<VMFunction>(""), FunctionType::SCRIPT};
+    script.locals.push_back(Local {"", 0, false});
+    current = &script;
+
+    for(Stmt* statement : statements)
+    {
+        compile(statement);
+    }
+    emitReturn();
+
+    current = nullptr;
+    return script.function;
+}
+
+void Compiler::compile(Stmt* stmt)
+{
+    stmt->accept(*this);
+}
+
+void Compiler::compile(Expr* expr)
+{
+    expr->accept(*this);
+}
+
+void Compiler::function(Function* stmt, FunctionType type)
+{
+    FunctionState state {current, makeObject<VMFunction>(std::string {stmt->name.lexeme()}), type};
+    state.function->arity = stmt->params.size();
+    // Slot zero holds the callee, or the receiver for methods.
+    bool isMethod = type == FunctionType::METHOD || type == FunctionType::INITIALIZER;
+    state.locals.push_back(Local {isMethod ? "this" : "", 0, false});
+    current = &state;
+
+    beginScope();
+    for(const Token& param : stmt->params)
+    {
+        addLocal(param.lexeme());
+        markInitialized();
+    }
+    for(Stmt* statement : stmt->body)
+    {
+        compile(statement);
+    }
+    emitReturn();
+
+    state.function->upvalueCount = state.upvalues.size();
+    current = state.enclosing;
+
+    line = stmt->name.line();
+    emitShort(OpCode::CLOSURE, makeConstant(state.function));
+    for(const Upvalue& upvalue : state.upvalues)
+    {
+        emit(upvalue.isLocal ? 1 : 0);
+        emit(upvalue.index);
+    }
+}
+
+LoxValue Compiler::visitAssignExpr(Assign& expr)
+{
+    compile(expr.value);
+    line = expr.name.line();
+    setVariable(expr.name.lexeme());
+    return nullptr;
+}
+
+LoxValue Compiler::visitBinaryExpr(Binary& expr)
+{
+    compile(expr.left);
+    compile(expr.right);
+
+    line = expr.op.line();
+    switch(expr.op.type)
+    {
+    case TokenType::BANG_EQUAL:
+        emit(OpCode::NOT_EQUAL);
+        break;
+    case TokenType::EQUAL_EQUAL:
+        emit(OpCode::EQUAL);
+        break;
+    case TokenType::GREATER:
+        emit(OpCode::GREATER);
+        break;
+    case TokenType::GREATER_EQUAL:
+        emit(OpCode::GREATER_EQUAL);
+        break;
+    case TokenType::LESS:
+        emit(OpCode::LESS);
+        break;
+    case TokenType::LESS_EQUAL:
+        emit(OpCode::LESS_EQUAL);
+        break;
+    case TokenType::PLUS:
+        emit(OpCode::ADD);
+        break;
+    case TokenType::MINUS:
+        emit(OpCode::SUBTRACT);
+        break;
+    case TokenType::STAR:
+        emit(OpCode::MULTIPLY);
+        break;
+    case TokenType::SLASH:
+        emit(OpCode::DIVIDE);
+        break;
+    default:
+        break;
+    }
+    return nullptr;
+}
+
+LoxValue Compiler::visitGroupingExpr(Grouping& expr)
+{
+    compile(expr.expression);
+    return nullptr;
+}
+
+LoxValue Compiler::visitLiteralExpr(Literal& expr)
+{
+    const LoxValue& value = expr.value;
+
+    if(value.isNil())
+    {
+        emit(OpCode::NIL);
+    }
+    else if(value.isBool())
+    {
+        emit(value.asBool() ? OpCode::TRUE : OpCode::FALSE);
+    }
+    else if(value.isNumber())
+    {
+        emitShort(OpCode::CONSTANT, numberConstant(value.asNumber()));
+    }
+    else
+    {
+        emitShort(OpCode::CONSTANT, stringConstant(value.asObject<LoxString>()->chars()));
+    }
+    return nullptr;
+}
+
+LoxValue Compiler::visitUnaryExpr(Unary& expr)
+{
+    compile(expr.right);
+
+    line = expr.op.line();
+    if(expr.op.type == TokenType::MINUS)
+    {
+        emit(OpCode::NEGATE);
+    }
+    else
+    {
+        emit(OpCode::NOT);
+    }
+    return nullptr;
+}
+
+LoxValue Compiler::visitVariableExpr(Variable& expr)
+{
+    line = expr.name.line();
+    getVariable(expr.name.lexeme());
+    return nullptr;
+}
+
+LoxValue Compiler::visitLogicalExpr(Logical& expr)
+{
+    compile(expr.left);
+
+    if(expr.op.type == TokenType::OR)
+    {
+        int elseJump = emitJump(OpCode::JUMP_IF_FALSE);
+        int endJump = emitJump(OpCode::JUMP);
+        patchJump(elseJump);
+        emit(OpCode::POP);
+        compile(expr.right);
+        patchJump(endJump);
+    }
+    else
+    {
+        int endJump = emitJump(OpCode::JUMP_IF_FALSE);
+        emit(OpCode::POP);
+        compile(expr.right);
+        patchJump(endJump);
+    }
+    return nullptr;
+}
+
+LoxValue Compiler::visitCallExpr(Call& expr)
+{
+    // Method calls skip materialising a bound method: the receiver stays on
+    // the stack and the method is invoked on it directly.
+    if(Get* get = expr.property)
+    {
+        compile(get->object);
+        for(Expr* argument : expr.arguments)
+        {
+            compile(argument);
+        }
+        line = expr.paren.line();
+        emitShort(OpCode::INVOKE, stringConstant(get->name.lexeme()));
+        emit(static_cast<uint8_t>(expr.arguments.size()));
+        return nullptr;
+    }
+
+    if(Super* super = dynamic_cast<Super*>(expr.callee))
+    {
+        line = super->keyword.line();
+        getVariable("this");
+        for(Expr* argument : expr.arguments)
+        {
+            compile(argument);
+        }
+        line = super->keyword.line();
+        getVariable("super");
+        line = expr.paren.line();
+        emitShort(OpCode::SUPER_INVOKE, stringConstant(super->method.lexeme()));
+        emit(static_cast<uint8_t>(expr.arguments.size()));
+        return nullptr;
+    }
+
+    compile(expr.callee);
+    for(Expr* argument : expr.arguments)
+    {
+        compile(argument);
+    }
+    line = expr.paren.line();
+    emit(OpCode::CALL, static_cast<uint8_t>(expr.arguments.size()));
+    return nullptr;
+}
+
+LoxValue Compiler::visitGetExpr(Get& expr)
+{
+    compile(expr.object);
+    line = expr.name.line();
+    emitShort(OpCode::GET_PROPERTY, stringConstant(expr.name.lexeme()));
+    return nullptr;
+}
+
+LoxValue Compiler::visitSetExpr(Set& expr)
+{
+    compile(expr.object);
+    compile(expr.value);
+    line = expr.name.line();
+    emitShort(OpCode::SET_PROPERTY, stringConstant(expr.name.lexeme()));
+    return nullptr;
+}
+
+LoxValue Compiler::visitThisExpr(This& expr)
+{
+    line = expr.keyword.line();
+    getVariable("this");
+    return nullptr;
+}
+
+LoxValue Compiler::visitSuperExpr(Super& expr)
+{
+    line = expr.keyword.line();
+    getVariable("this");
+    getVariable("super");
+    line = expr.method.line();
+    emitShort(OpCode::GET_SUPER, stringConstant(expr.method.lexeme()));
+    return nullptr;
+}
+
+void Compiler::visitBlockStmt(Block& stmt)
+{
+    beginScope();
+    for(Stmt* statement : stmt.statements)
+    {
+        compile(statement);
+    }
+    endScope();
+}
+
+void Compiler::visitExpressionStmt(Expression& stmt)
+{
+    compile(stmt.expression);
+    emit(OpCode::POP);
+}
+
+void Compiler::visitPrintStmt(Print& stmt)
+{
+    compile(stmt.expression);
+    emit(OpCode::PRINT);
+}
+
+void Compiler::visitVarStmt(Var& stmt)
+{
+    line = stmt.name.line();
+    declareVariable(stmt.name);
+
+    if(stmt.initializer != nullptr)
+    {
+        compile(stmt.initializer);
+    }
+    else
+    {
+        emit(OpCode::NIL);
+    }
+
+    line = stmt.name.line();
+    defineVariable(stmt.name);
+}
+
+void Compiler::visitIfStmt(If& stmt)
+{
+    compile(stmt.condition);
+
+    int thenJump = emitJump(OpCode::JUMP_IF_FALSE);
+    emit(OpCode::POP);
+    compile(stmt.thenBranch);
+
+    int elseJump = emitJump(OpCode::JUMP);
+    patchJump(thenJump);
+    emit(OpCode::POP);
+
+    if(stmt.elseBranch != nullptr)
+    {
+        compile(stmt.elseBranch);
+    }
+    patchJump(elseJump);
+}
+
+void Compiler::visitWhileStmt(While& stmt)
+{
+    int loopStart = chunk().code.size();
+    compile(stmt.condition);
+
+    int exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+    emit(OpCode::POP);
+    compile(stmt.body);
+    emitLoop(loopStart);
+
+    patchJump(exitJump);
+    emit(OpCode::POP);
+}
+
+void Compiler::visitFunctionStmt(Function& stmt)
+{
+    line = stmt.name.line();
+    declareVariable(stmt.name);
+    // A local function may refer to itself, so it is usable before its body.
+    markInitialized();
+    function(&stmt, FunctionType::FUNCTION);
+    defineVariable(stmt.name);
+}
+
+void Compiler::visitReturnStmt(Return& stmt)
+{
+    if(stmt.value == nullptr)
+    {
+        line = stmt.keyword.line();
+        emitReturn();
+        return;
+    }
+
+    compile(stmt.value);
+    line = stmt.keyword.line();
+    emit(OpCode::RETURN);
+}
+
+void Compiler::visitClassStmt(Class& stmt)
+{
+    line = stmt.name.line();
+    uint16_t nameConstant = stringConstant(stmt.name.lexeme());
+    declareVariable(stmt.name);
+    emitShort(OpCode::CLASS, nameConstant);
+    defineVariable(stmt.name);
+
+    ClassState classState {currentClass, false};
+    currentClass = &classState;
+
+    if(stmt.superclass != nullptr)
+    {
+        compile(stmt.superclass);
+
+        beginScope();
+        addLocal("super");
+        markInitialized();
+
+        line = stmt.name.line();
+        getVariable(stmt.name.lexeme());
+        line = stmt.superclass->name.line();
+        emit(OpCode::INHERIT);
+        classState.hasSuperclass = true;
+    }
+
+    line = stmt.name.line();
+    getVariable(stmt.name.lexeme());
+    for(Function* method : stmt.methods)
+    {
+        line = method->name.line();
+        uint16_t methodConstant = stringConstant(method->name.lexeme());
+        FunctionType type = method->name.lexeme() == "init" ? FunctionType::INITIALIZER : FunctionType::METHOD;
+        function(method, type);
+        emitShort(OpCode::METHOD, methodConstant);
+    }
+    emit(OpCode::POP);
+
+    if(classState.hasSuperclass)
+    {
+        endScope();
+    }
+
+    currentClass = classState.enclosing;
+}
+
+Chunk& Compiler::chunk()
+{
+    return current->function->chunk;
+}
+
+void Compiler::emit(uint8_t byte)
+{
+    chunk().write(byte, line);
+}
+
+void Compiler::emit(OpCode op)
+{
+    chunk().write(op, line);
+}
+
+void Compiler::emit(OpCode op, uint8_t operand)
+{
+    emit(op);
+    emit(operand);
+}
+
+void Compiler::emitShort(OpCode op, uint16_t operand)
+{
+    emit(op);
+    emit(static_cast<uint8_t>(operand >> 8));
+    emit(static_cast<uint8_t>(operand & 0xff));
+}
+
+int Compiler::emitJump(OpCode op)
+{
+    emitShort(op, 0xffff);
+    return chunk().code.size() - 2;
+}
+
+void Compiler::patchJump(int offset)
+{
+    int jump = chunk().code.size() - offset - 2;
+    if(jump > UINT16_MAX)
+    {
+        error(line, "Too much code to jump over.");
+    }
+
+    chunk().code[offset] = (jump >> 8) & 0xff;
+    chunk().code[offset + 1] = jump & 0xff;
+}
+
+void Compiler::emitLoop(int loopStart)
+{
+    emit(OpCode::LOOP);
+
+    int offset = chunk().code.size() - loopStart + 2;
+    if(offset > UINT16_MAX)
+    {
+        error(line, "Loop body too large.");
+    }
+
+    emit(static_cast<uint8_t>((offset >> 8) & 0xff));
+    emit(static_cast<uint8_t>(offset & 0xff));
+}
+
+void Compiler::emitReturn()
+{
+    if(current->type == FunctionType::INITIALIZER)
+    {
+        emit(OpCode::GET_LOCAL, 0);
+    }
+    else
+    {
+        emit(OpCode::NIL);
+    }
+    emit(OpCode::RETURN);
+}
+
+uint16_t Compiler::makeConstant(LoxValue value)
+{
+    int constant = chunk().addConstant(std::move(value));
+    if(constant > UINT16_MAX)
+    {
+        error(line, "Too many constants in one chunk.");
+        return 0;
+    }
+    return constant;
+}
+
+uint16_t Compiler::stringConstant(std::string_view chars)
+{
+    auto elem = current->stringConstants.find(chars);
+    if(elem != current->stringConstants.end())
+    {
+        return elem->second;
+    }
+
+    uint16_t constant = makeConstant(LoxString::intern(chars));
+    current->stringConstants.emplace(chars, constant);
+    return constant;
+}
+
+uint16_t Compiler::numberConstant(double number)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+
+    auto elem = current->numberConstants.find(bits);
+    if(elem != current->numberConstants.end())
+    {
+        return elem->second;
+    }
+
+    uint16_t constant = makeConstant(number);
+    current->numberConstants.emplace(bits, constant);
+    return constant;
+}
+
+uint16_t Compiler::globalSlot(std::string_view name)
+{
+    int slot = vm.globalSlot(std::string {name});
+    if(slot < 0)
+    {
+        error(line, "Too many global variables.");
+        return 0;
+    }
+    return slot;
+}
+
+void Compiler::beginScope()
+{
+    current->scopeDepth++;
+}
+
+void Compiler::endScope()
+{
+    current->scopeDepth--;
+
+    std::vector<Local>& locals = current->locals;
+    while(!locals.empty() && locals.back().depth > current->scopeDepth)
+    {
+        emit(locals.back().isCaptured ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+        locals.pop_back();
+    }
+}
+
+void Compiler::addLocal(std::string_view name)
+{
+    if(current->locals.size() > UINT8_MAX)
+    {
+        error(line, "Too many local variables in function.");
+        return;
+    }
+    current->locals.push_back(Local {name, -1, false});
+}
+
+void Compiler::markInitialized()
+{
+    if(current->scopeDepth == 0)
+    {
+        return;
+    }
+    current->locals.back().depth = current->scopeDepth;
+}
+
+void Compiler::declareVariable(const Token& name)
+{
+    if(current->scopeDepth == 0)
+    {
+        return;
+    }
+    addLocal(name.lexeme());
+}
+
+void Compiler::defineVariable(const Token& name)
+{
+    if(current->scopeDepth > 0)
+    {
+        markInitialized();
+        return;
+    }
+    emitShort(OpCode::DEFINE_GLOBAL, globalSlot(name.lexeme()));
+}
+
+void Compiler::getVariable(std::string_view name)
+{
+    int arg = resolveLocal(current, name);
+    if(arg != -1)
+    {
+        emit(OpCode::GET_LOCAL, arg);
+    }
+    else if((arg = resolveUpvalue(current, name)) != -1)
+    {
+        emit(OpCode::GET_UPVALUE, arg);
+    }
+    else
+    {
+        emitShort(OpCode::GET_GLOBAL, globalSlot(name));
+    }
+}
+
+void Compiler::setVariable(std::string_view name)
+{
+    int arg = resolveLocal(current, name);
+    if(arg != -1)
+    {
+        emit(OpCode::SET_LOCAL, arg);
+    }
+    else if((arg = resolveUpvalue(current, name)) != -1)
+    {
+        emit(OpCode::SET_UPVALUE, arg);
+    }
+    else
+    {
+        emitShort(OpCode::SET_GLOBAL, globalSlot(name));
+    }
+}
+
+int Compiler::resolveLocal(FunctionState* state, std::string_view name)
+{
+    for(int i = state->locals.size() - 1; i >= 0; i--)
+    {
+        if(state->locals[i].name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Compiler::resolveUpvalue(FunctionState* state, std::string_view name)
+{
+    if(state->enclosing == nullptr)
+    {
+        return -1;
+    }
+
+    int local = resolveLocal(state->enclosing, name);
+    if(local != -1)
+    {
+        state->enclosing->locals[local].isCaptured = true;
+        return addUpvalue(state, static_cast<uint8_t>(local), true);
+    }
+
+    int upvalue = resolveUpvalue(state->enclosing, name);
+    if(upvalue != -1)
+    {
+        return addUpvalue(state, static_cast<uint8_t>(upvalue), false);
+    }
+
+    return -1;
+}
+
+int Compiler::addUpvalue(FunctionState* state, uint8_t index, bool isLocal)
+{
+    for(int i = 0; i < state->upvalues.size(); i++)
+    {
+        const Upvalue& upvalue = state->upvalues[i];
+        if(upvalue.index == index && upvalue.isLocal == isLocal)
+        {
+            return i;
+        }
+    }
+
+    if(state->upvalues.size() > UINT8_MAX)
+    {
+        error(line, "Too many closure variables in function.");
+        return 0;
+    }
+
+    state->upvalues.push_back(Upvalue {index, isLocal});
+    return state->upvalues.size() - 1;
+}
@@ -1,63 +1,33 @@
 #include "./headers/Environment.hpp"
 
-#include <iostream>
-
-std::any Environment::get(Token name)
+LoxValue Environment::get(const Token& name)
 {
-    if (values.find(name.lexeme) != values.end())
+    auto elem = values.find(name.symbol());
+    if (elem != values.end())
     {
-        if(values[name.lexeme].type() == typeid(std::nullptr_t))
+        if(elem->second.isNil())
         {
-            throw RuntimeError(name, "Unassigned variable '" + name.lexeme + "'.");
+            throw RuntimeError(name, "Unassigned variable '" + std::string(name.lexeme()) + "'.");
         }
-        return values[name.lexeme];
+        return elem->second;
     }
 
-    if(enclosing != nullptr) return enclosing->get(name);
-
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+    throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme()) + "'.");
 }
 
-void Environment::define(std::string name, std::any value)
+void Environment::define(Ref<LoxString> name, LoxValue value)
 {
-    values[name] = value;
+    values[std::move(name)] = std::move(value);
 }
 
-void Environment::assign(Token name, std::any value)
+void Environment::assign(const Token& name, LoxValue value)
 {
-    if (values.find(name.lexeme) != values.end())
+    auto elem = values.find(name.symbol());
+    if (elem != values.end())
     {
-        values[name.lexeme] = value;
+        elem->second = std::move(value);
         return;
     }
 
-    if(enclosing != nullptr)
-    {
-        enclosing->assign(name, value);
-        return;
-    }
-
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
-}
-
-std::any Environment::getAt(int distance, std::string name)
-{
-    return ancestor(distance)->values[name];
-}
-
-std::shared_ptr<Environment> Environment::ancestor(int distance)
-{
-    std::shared_ptr<Environment> environment = shared_from_this();
-
-    for(int i = 0; i < distance; i++) {
-        environment = environment->enclosing;
-    }
-
-    return environment;
-
+    throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme()) + "'.");
 }
-
-void Environment::assignAt(int distance, Token& name, std::any value)
-{
-    ancestor(distance)->values[name.lexeme] = value;
-}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "./headers/Heap.hpp"
+#include "./headers/LoxObject.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+static constexpr size_t MIN_THRESHOLD = 1 << 20;
+static constexpr size_t GROWTH_FACTOR = 2;
+// Young objects that may survive before a minor collection looks at them.
+static constexpr size_t YOUNG_LIMIT = 4096;
+
+static constexpr size_t CHUNK_SIZE = 64 * 1024;
+static constexpr size_t GRANULE = 16;
+static constexpr size_t SIZE_CLASSES = Heap::MAX_SMALL_SIZE / GRANULE;
+
+// Chunks are aligned to their size so the chunk, and with it the size of a
+// cell, can be found from any pointer into it.
+struct alignas(GRANULE) ChunkHeader
+{
+    size_t cellSize;
+};
+
+struct FreeCell
+{
+    FreeCell* next;
+};
+
+struct SizeClass
+{
+    FreeCell* free = nullptr;
+    char* top = nullptr;
+    char* end = nullptr;
+};
+
+static SizeClass sizeClasses[SIZE_CLASSES];
+
+void* Heap::allocate(size_t size)
+{
+    if(!collecting)
+    {
+        if(bytesAllocated + size > threshold)
+        {
+            collect();
+        }
+        else if(young.count > YOUNG_LIMIT)
+        {
+            collectYoung();
+        }
+    }
+
+    if(size <= MAX_SMALL_SIZE)
+    {
+        return allocateSmall(size);
+    }
+    bytesAllocated += size;
+    return ::operator new(size);
+}
+
+void* Heap::allocateSmall(size_t size)
+{
+    size_t index = (size + GRANULE - 1) / GRANULE - 1;
+    size_t cellSize = (index + 1) * GRANULE;
+    SizeClass& sizeClass = sizeClasses[index];
+    bytesAllocated += cellSize;
+
+    if(sizeClass.free != nullptr)
+    {
+        FreeCell* cell = sizeClass.free;
+        sizeClass.free = cell->next;
+        return cell;
+    }
+
+    if(sizeClass.top + cellSize > sizeClass.end)
+    {
+        char* chunk = static_cast<char*>(::operator new(CHUNK_SIZE, std::align_val_t {CHUNK_SIZE}));
+        new(chunk) ChunkHeader {cellSize};
+        sizeClass.top = chunk + sizeof(ChunkHeader);
+        sizeClass.end = chunk + CHUNK_SIZE;
+    }
+
+    void* cell = sizeClass.top;
+    sizeClass.top += cellSize;
+    return cell;
+}
+
+// `size` is the static size of the object's class, which for a LoxInstance
+// leaves out its inline fields; the chunk header has the real one.
+void Heap::deallocate(void* pointer, size_t size)
+{
+    if(size > MAX_SMALL_SIZE)
+    {
+        bytesAllocated -= size;
+        ::operator delete(pointer);
+        return;
+    }
+
+    auto chunk = reinterpret_cast<ChunkHeader*>(reinterpret_cast<uintptr_t>(pointer) & ~(CHUNK_SIZE - 1));
+    size_t cellSize = chunk->cellSize;
+    SizeClass& sizeClass = sizeClasses[cellSize / GRANULE - 1];
+    bytesAllocated -= cellSize;
+
+    FreeCell* cell = new(pointer) FreeCell {sizeClass.free};
+    sizeClass.free = cell;
+}
+
+// Removes references held by tracked objects from the counts of the tracked
+// objects they point to.
+class Heap::Unreference : public Tracer
+{
+public:
+    using Tracer::visit;
+
+    void visit(LoxObject* object) override;
+};
+
+// Marks what a reachable object refers to as reachable too.
+class Heap::Mark : public Tracer
+{
+public:
+    using Tracer::visit;
+    std::vector<LoxObject*>& worklist;
+
+    Mark(std::vector<LoxObject*>& worklist) : worklist {worklist} {}
+    void visit(LoxObject* object) override;
+};
+
+void Heap::Unreference::visit(LoxObject* object)
+{
+    if(object != nullptr && object->gcState == LoxObject::GCState::COLLECTING)
+    {
+        object->gcRefs--;
+    }
+}
+
+void Heap::Mark::visit(LoxObject* object)
+{
+    if(object != nullptr && object->gcState == LoxObject::GCState::COLLECTING)
+    {
+        object->gcState = LoxObject::GCState::REACHABLE;
+        worklist.push_back(object);
+    }
+}
+
+void Heap::collect()
+{
+    promoteYoung();
+    collect(old);
+    heapStats.collections++;
+    threshold = std::max(MIN_THRESHOLD, bytesAllocated * GROWTH_FACTOR);
+}
+
+void Heap::collectYoung()
+{
+    collect(young);
+    heapStats.objectsPromoted += young.count;
+    promoteYoung();
+    heapStats.minorCollections++;
+}
+
+// Moves every young object to the old generation.
+void Heap::promoteYoung()
+{
+    if(young.objects == nullptr)
+    {
+        return;
+    }
+
+    LoxObject* last = young.objects;
+    last->gcState = LoxObject::GCState::OLD;
+    while(last->gcNext != nullptr)
+    {
+        last = last->gcNext;
+        last->gcState = LoxObject::GCState::OLD;
+    }
+
+    last->gcNext = old.objects;
+    if(old.objects != nullptr)
+    {
+        old.objects->gcPrev = last;
+    }
+    old.objects = young.objects;
+    old.count += young.count;
+    young = Generation {};
+}
+
+void Heap::collect(Generation& generation)
+{
+    collecting = true;
+    size_t bytesBefore = bytesAllocated;
+    size_t objectsBefore = generation.count;
+    LoxObject::GCState state = &generation == &old ? LoxObject::GCState::OLD : LoxObject::GCState::YOUNG;
+
+    for(LoxObject* object = generation.objects; object != nullptr; object = object->gcNext)
+    {
+        object->gcState = LoxObject::GCState::COLLECTING;
+        object->gcRefs = object->refCount;
+    }
+
+    Unreference unreference;
+    for(LoxObject* object = generation.objects; object != nullptr; object = object->gcNext)
+    {
+        object->trace(unreference);
+    }
+
+    // Anything with references left over is referenced from outside the
+    // objects being collected, so it is a root.
+    std::vector<LoxObject*> worklist;
+    for(LoxObject* object = generation.objects; object != nullptr; object = object->gcNext)
+    {
+        if(object->gcRefs > 0)
+        {
+            object->gcState = LoxObject::GCState::REACHABLE;
+            worklist.push_back(object);
+        }
+    }
+
+    Mark mark {worklist};
+    while(!worklist.empty())
+    {
+        LoxObject* object = worklist.back();
+        worklist.pop_back();
+        object->trace(mark);
+    }
+
+    std::vector<LoxObject*> garbage;
+    for(LoxObject* object = generation.objects; object != nullptr; object = object->gcNext)
+    {
+        if(object->gcState == LoxObject::GCState::COLLECTING)
+        {
+            garbage.push_back(object);
+        }
+        object->gcState = state;
+    }
+
+    // Hold every garbage object while the cycles are cut, so none is freed
+    // while another is still clearing references to it.
+    for(LoxObject* object : garbage)
+    {
+        retainObject(object);
+    }
+    for(LoxObject* object : garbage)
+    {
+        object->clearReferences();
+    }
+    for(LoxObject* object : garbage)
+    {
+        releaseObject(object);
+    }
+
+    heapStats.objectsFreed += objectsBefore - generation.count;
+    heapStats.bytesFreed += bytesBefore - bytesAllocated;
+    collecting = false;
+}
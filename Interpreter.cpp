@@ -1,14 +1,16 @@
 #include "./headers/Interpreter.hpp"
 
+#include <algorithm>
+
 int NativeClock::arity()
 {
     return 0;
 }
 
-std::any NativeClock::call(Interpreter& interpreter, std::vector<std::any> arguments)
+LoxValue NativeClock::call(Interpreter& interpreter, std::vector<LoxValue> arguments)
 {
     auto ticks = std::chrono::system_clock::now().time_since_epoch();
-    return std::chrono::duration<double>{ticks}.count() / 1000.0;
+    return std::chrono::duration<double>{ticks}.count();
 }
 
 std::string NativeClock::toString()
@@ -18,14 +20,15 @@ std::string NativeClock::toString()
 
 Interpreter::Interpreter()
 {
-    globals->define("clock", std::shared_ptr<NativeClock>{});
+    globals.define(LoxString::intern("clock"), makeObject<NativeClock>());
 }
 
-void Interpreter::interpret(std::vector<std::shared_ptr<Stmt>> statements)
+void Interpreter::interpret(const std::vector<Stmt*>& statements, int frameSize)
 {
+    frameTop = frame + frameSize;
     try
     {
-        for(std::shared_ptr<Stmt> statement : statements)
+        for(Stmt* statement : statements)
         {
             execute(statement);
         }
@@ -34,469 +37,497 @@ void Interpreter::interpret(std::vector<std::shared_ptr<Stmt>> statements)
     {
         runtimeError(error);
     }
+    std::fill(frame, frameTop, nullptr);
+    frameTop = frame;
 }
 
-void Interpreter::resolve(std::shared_ptr<Expr> expr, int depth)
-{
-    locals[expr] = depth;
-}
-
-std::any Interpreter::visitLiteralExpr(std::shared_ptr<Literal> expr)
+LoxValue Interpreter::visitLiteralExpr(Literal& expr)
 {
-    return expr->value;
+    return expr.value;
 }
 
-std::any Interpreter::visitLogicalExpr(std::shared_ptr<Logical> expr) 
+LoxValue Interpreter::visitLogicalExpr(Logical& expr) 
 {
-    std::any left = evaluate(expr->left);
+    LoxValue left = evaluate(expr.left);
 
-    if(expr->op.type == TokenType::OR)
+    if(expr.op.type == TokenType::OR)
     {
-        if(isTruthy(left)) return left;
+        if(left.isTruthy()) return left;
     } 
     else 
     {
-        if(!isTruthy(left)) return left;
+        if(!left.isTruthy()) return left;
     }
 
-    return evaluate(expr->right);
+    return evaluate(expr.right);
 }
 
-std::any Interpreter::visitGroupingExpr(std::shared_ptr<Grouping> expr)
+LoxValue Interpreter::visitGroupingExpr(Grouping& expr)
 {
-    return evaluate(expr->expression);
+    return evaluate(expr.expression);
 }
 
-std::any Interpreter::visitUnaryExpr(std::shared_ptr<Unary> expr)
+LoxValue Interpreter::visitUnaryExpr(Unary& expr)
 {
-    std::any right = evaluate(expr->right);
+    LoxValue right = evaluate(expr.right);
 
-    switch (expr->op.type)
+    switch (expr.op.type)
     {
     case TokenType::MINUS:
-        checkNumberOperand(expr->op, right);
-        return -std::any_cast<double>(right);
+        checkNumberOperand(expr.op, right);
+        return -right.asNumber();
     case TokenType::BANG:
-        return !std::any_cast<bool>(right);
+        return !right.isTruthy();
     default:
         return nullptr;
     }
 }
 
-std::any Interpreter::visitAssignExpr(std::shared_ptr<Assign> expr)
+LoxValue Interpreter::visitAssignExpr(Assign& expr)
 {
-    std::any value = evaluate(expr->value);
-
-    auto elem = locals.find(expr);
-    if(elem != locals.end())
-    {
-        int distance = elem->second;
-        environment->assignAt(distance, expr->name, value);
-    } 
-    else 
-    {
-        globals->assign(expr->name, value);
-    }
-    
+    LoxValue value = evaluate(expr.value);
+    assign(expr.local, expr.name, value);
     return value;
 }
 
-std::any Interpreter::visitBinaryExpr(std::shared_ptr<Binary> expr)
+LoxValue Interpreter::visitBinaryExpr(Binary& expr)
 {
-    std::any left = evaluate(expr->left);
-    std::any right = evaluate(expr->right);
+    LoxValue left = evaluate(expr.left);
+    LoxValue right = evaluate(expr.right);
 
-    switch (expr->op.type)
+    switch (expr.op.type)
     {
     case TokenType::MINUS:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) - std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() - right.asNumber();
     case TokenType::SLASH:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) / std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() / right.asNumber();
     case TokenType::STAR:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) * std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() * right.asNumber();
     case TokenType::PLUS:
-        if (left.type() == typeid(double) && right.type() == typeid(double))
+        if (left.isNumber() && right.isNumber())
         {
-            return std::any_cast<double>(left) + std::any_cast<double>(right);
+            return left.asNumber() + right.asNumber();
         }
-        if (left.type() == typeid(std::string) && right.type() == typeid(std::string))
+        if (left.isString() && right.isString())
         {
-            return std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
+            return LoxString::concat(left.asObject<LoxString>(), right.asObject<LoxString>());
         }
-        throw RuntimeError(expr->op, "Operands must be two numbers or two strings.");
+        throw RuntimeError(expr.op, "Operands must be two numbers or two strings.");
     case TokenType::GREATER:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) > std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() > right.asNumber();
     case TokenType::GREATER_EQUAL:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) >= std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() >= right.asNumber();
     case TokenType::LESS:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) < std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() < right.asNumber();
     case TokenType::LESS_EQUAL:
-        checkNumberOperands(expr->op, left, right);
-        return std::any_cast<double>(left) <= std::any_cast<double>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() <= right.asNumber();
     case TokenType::BANG_EQUAL:
-        return !isEqual(left, right);
+        return !left.equals(right);
     case TokenType::EQUAL_EQUAL:
-        return isEqual(left, right);
+        return left.equals(right);
     default:
         return nullptr;
     }
 }
 
-std::any Interpreter::visitVariableExpr(std::shared_ptr<Variable> expr)
+LoxValue Interpreter::visitVariableExpr(Variable& expr)
+{
+    return lookUpVariable(expr.name, expr.local);
+}
+
+LoxValue Interpreter::visitCallExpr(Call& expr)
 {
-    return lookUpVariable(expr->name, expr);
+    if(expr.property != nullptr)
+    {
+        return invoke(expr, *expr.property);
+    }
+
+    LoxValue callee = evaluate(expr.callee);
+    return call(callee, expr);
 }
 
-std::any Interpreter::visitCallExpr(std::shared_ptr<Call> expr)
+// Calls `receiver.name(...)`. A method is run directly on its receiver; a
+// bound method object is only created when the method value escapes
+// through a plain Get.
+LoxValue Interpreter::invoke(Call& expr, Get& property)
 {
-    std::any callee = evaluate(expr->callee);
+    LoxValue object = evaluate(property.object);
+    if(!object.isInstance())
+    {
+        throw RuntimeError(property.name, "Only instances have properties.");
+    }
 
-    std::vector<std::any> arguments;
-    for(std::shared_ptr<Expr>& argument : expr->arguments) 
+    LoxInstance* instance = object.asObject<LoxInstance>();
+    LoxFunction* method = instance->getMethod(property.name, property.cache);
+    if(method == nullptr)
     {
-        arguments.push_back(evaluate(argument));
+        return call(instance->get(property.name, property.cache), expr);
     }
 
-    std::shared_ptr<LoxCallable> function;
+    std::vector<LoxValue> arguments = evaluateArguments(expr);
+    checkArity(expr, method, arguments.size());
+    return method->invoke(*this, instance, std::move(arguments));
+}
 
-    if (callee.type() == typeid(std::shared_ptr<LoxFunction>)) {
-      function = std::any_cast<std::shared_ptr<LoxFunction>>(callee);
-    } else if (callee.type() == typeid(std::shared_ptr<LoxClass>)) {
-      function = std::any_cast<std::shared_ptr<LoxClass>>(callee);
-    } else {
-      throw RuntimeError{expr->paren,
+LoxValue Interpreter::call(const LoxValue& callee, Call& expr)
+{
+    std::vector<LoxValue> arguments = evaluateArguments(expr);
+
+    if (!callee.isCallable()) {
+      throw RuntimeError{expr.paren,
           "Can only call functions and classes."};
     }
 
-    if(arguments.size() != function->arity())
+    LoxCallable* function = callee.asObject<LoxCallable>();
+    checkArity(expr, function, arguments.size());
+    return function->call(*this, std::move(arguments));
+}
+
+std::vector<LoxValue> Interpreter::evaluateArguments(Call& expr)
+{
+    std::vector<LoxValue> arguments;
+    arguments.reserve(expr.arguments.size());
+    for(Expr* argument : expr.arguments) 
     {
-        throw RuntimeError{expr->paren, "Expected " +
-          std::to_string(function->arity()) + " arguments but got " +
-          std::to_string(arguments.size()) + "."};
+        arguments.push_back(evaluate(argument));
     }
+    return arguments;
+}
 
-    return function->call(*this, std::move(arguments));
+void Interpreter::checkArity(Call& expr, LoxCallable* function, int argumentCount)
+{
+    if(argumentCount != function->arity())
+    {
+        throw RuntimeError{expr.paren, "Expected " +
+          std::to_string(function->arity()) + " arguments but got " +
+          std::to_string(argumentCount) + "."};
+    }
 }
 
-std::any Interpreter::visitGetExpr(std::shared_ptr<Get> expr)
+LoxValue Interpreter::visitGetExpr(Get& expr)
 {
-    std::any object = evaluate(expr->object);
-    if(object.type() == typeid(std::shared_ptr<LoxInstance>))
+    LoxValue object = evaluate(expr.object);
+    if(object.isInstance())
     {
-        return std::any_cast<std::shared_ptr<LoxInstance>>(object)->get(expr->name);
+        return object.asObject<LoxInstance>()->get(expr.name, expr.cache);
     }
 
-    throw RuntimeError(expr->name, "Only instances have properties.");
+    throw RuntimeError(expr.name, "Only instances have properties.");
 }
 
-std::any Interpreter::visitSetExpr(std::shared_ptr<Set> expr)
+LoxValue Interpreter::visitSetExpr(Set& expr)
 {
-    std::any object = evaluate(expr->object);
+    LoxValue object = evaluate(expr.object);
 
-    if(object.type() != typeid(std::shared_ptr<LoxInstance>))
+    if(!object.isInstance())
     {
-        throw RuntimeError(expr->name, "Only instances have fields.");
+        throw RuntimeError(expr.name, "Only instances have fields.");
     }
 
-    std::any value = evaluate(expr->value);
-    std::any_cast<std::shared_ptr<LoxInstance>>(object)->set(expr->name, value);
+    LoxValue value = evaluate(expr.value);
+    object.asObject<LoxInstance>()->set(expr.name, value, expr.cache);
 
-    return nullptr;
+    return value;
 }
 
-std::any Interpreter::visitThisExpr(std::shared_ptr<This> expr)
+LoxValue Interpreter::visitThisExpr(This& expr)
 {
-    return lookUpVariable(expr->keyword, expr);
+    return lookUpVariable(expr.keyword, expr.local);
 }
 
-std::any Interpreter::visitSuperExpr(std::shared_ptr<Super> expr)
+LoxValue Interpreter::visitSuperExpr(Super& expr)
 {
-    int distance = locals[expr];
-    auto superclass = std::any_cast<
-        std::shared_ptr<LoxClass>>(environment->getAt(
-            distance, "super"));
-
-    auto object = std::any_cast<std::shared_ptr<LoxInstance>>(
-        environment->getAt(distance - 1, "this"));
+    LoxClass* superclass = lookUpVariable(expr.keyword, expr.local).asObject<LoxClass>();
+    LoxValue object = lookUpVariable(expr.keyword, expr.thisLocal);
 
-    std::shared_ptr<LoxFunction> method = superclass->findMethod(
-        expr->method.lexeme);
+    PropertyCache& cache = expr.cache;
+    if(cache.klass.get() != superclass)
+    {
+        cache.klass = Ref<LoxObject>(superclass);
+        cache.method = superclass->findMethod(expr.method.symbol());
+    }
+    LoxFunction* method = cache.method;
 
     if (method == nullptr) {
-      throw RuntimeError(expr->method,
-          "Undefined property '" + expr->method.lexeme + "'.");
+      throw RuntimeError(expr.method,
+          "Undefined property '" + std::string(expr.method.lexeme()) + "'.");
     }
 
-    return method->bind(object);
+    return method->bind(object.asObject<LoxInstance>());
 }
 
-std::any Interpreter::visitExpressionStmt(std::shared_ptr<Expression> stmt)
+void Interpreter::visitExpressionStmt(Expression& stmt)
 {
-    evaluate(stmt->expression);
-    return nullptr;
+    evaluate(stmt.expression);
 }
 
-std::any Interpreter::visitPrintStmt(std::shared_ptr<Print> stmt)
+void Interpreter::visitPrintStmt(Print& stmt)
 {
-    std::any value = evaluate(stmt->expression);
-    std::cout << stringify(value) << "\n";
-    return nullptr;
+    LoxValue value = evaluate(stmt.expression);
+    std::cout << value.toString() << "\n";
 }
 
-std::any Interpreter::visitVarStmt(std::shared_ptr<Var> stmt)
+void Interpreter::visitVarStmt(Var& stmt)
 {
-    std::any value = nullptr;
-    if (stmt->initializer != nullptr)
+    LoxValue value = nullptr;
+    if (stmt.initializer != nullptr)
     {
-        value = evaluate(stmt->initializer);
+        value = evaluate(stmt.initializer);
     }
-    environment->define(stmt->name.lexeme, value);
-    return nullptr;
+    define(stmt.local, stmt.name, std::move(value));
 }
 
-std::any Interpreter::visitBlockStmt(std::shared_ptr<Block> stmt)
+void Interpreter::visitBlockStmt(Block& stmt)
 {
-    executeBlock(stmt->statements, std::make_shared<Environment>(environment));
-    return nullptr;
+    for(Stmt* statement : stmt.statements)
+    {
+        if(execute(statement) == Completion::RETURN)
+        {
+            break;
+        }
+    }
+    std::fill(frame + stmt.frameSlot, frame + stmt.frameSlot + stmt.slotCount, nullptr);
 }
 
-std::any Interpreter::visitIfStmt(std::shared_ptr<If> stmt) 
+void Interpreter::visitIfStmt(If& stmt) 
 {
-    if(isTruthy(evaluate(stmt->condition)))
+    if(evaluate(stmt.condition).isTruthy())
     {
-        execute(stmt->thenBranch);
+        execute(stmt.thenBranch);
     }
     else 
     {
-        if(stmt->elseBranch != nullptr)
+        if(stmt.elseBranch != nullptr)
         {
-            execute(stmt->elseBranch);
+            execute(stmt.elseBranch);
         }
     }
-    return {};
 }
 
-std::any Interpreter::visitWhileStmt(std::shared_ptr<While> stmt)
+void Interpreter::visitWhileStmt(While& stmt)
 {
-    while(isTruthy(evaluate(stmt->condition)))
+    while(evaluate(stmt.condition).isTruthy())
     {
-        execute(stmt->body);
+        if(execute(stmt.body) == Completion::RETURN)
+        {
+            break;
+        }
     }
-    
-    return nullptr;
 }
 
-std::any Interpreter::visitFunctionStmt(std::shared_ptr<Function> stmt)
+void Interpreter::visitFunctionStmt(Function& stmt)
 {
-    std::shared_ptr<LoxFunction> function = std::make_shared<LoxFunction>(stmt, environment, false);
-    environment->define(stmt->name.lexeme, function);
-    return nullptr;
+    // Declared first so a recursive function can capture its own box.
+    define(stmt.local, stmt.name, nullptr);
+    assign(stmt.local, stmt.name, closure(&stmt, false));
 }
 
-std::any Interpreter::visitReturnStmt(std::shared_ptr<Return> stmt) 
+void Interpreter::visitReturnStmt(Return& stmt) 
 {
-    std::any value = nullptr;
-    if(stmt->value != nullptr)
+    LoxValue value = nullptr;
+    if(stmt.value != nullptr)
     {
-        value = evaluate(stmt->value);
+        value = evaluate(stmt.value);
     }
-    throw LoxReturn{value};
+    returnValue = std::move(value);
+    completion = Completion::RETURN;
 }
 
-std::any Interpreter::visitClassStmt(std::shared_ptr<Class> stmt)
+void Interpreter::visitClassStmt(Class& stmt)
 {
-    std::any superclass = nullptr;
-    if(stmt->superclass != nullptr)
+    LoxValue superclass = nullptr;
+    if(stmt.superclass != nullptr)
     {
-        superclass = evaluate(stmt->superclass);
-        if(superclass.type() != typeid(std::shared_ptr<LoxClass>))
+        superclass = evaluate(stmt.superclass);
+        if(!superclass.isClass())
         {
-            throw RuntimeError(stmt->superclass->name, "Superclass must be a class.");
+            throw RuntimeError(stmt.superclass->name, "Superclass must be a class.");
         }
 
     }
-    environment->define(stmt->name.lexeme, nullptr);
+    define(stmt.local, stmt.name, nullptr);
 
-    if(stmt->superclass != nullptr)
+    if(stmt.superclass != nullptr)
     {
-        environment = std::make_shared<Environment>(environment);
-        environment->define("super", superclass);
+        define(stmt.superLocal, stmt.superclass->name, superclass);
     }
 
-    std::map<std::string, std::shared_ptr<LoxFunction>> methods;
-    for(std::shared_ptr<Function> method : stmt->methods)
+    std::unordered_map<Ref<LoxString>, Ref<LoxFunction>> methods;
+    for(Function* method : stmt.methods)
     {
-        std::shared_ptr<LoxFunction> function = std::make_shared<LoxFunction>(method, environment, method->name.lexeme == "init");
-        methods[method->name.lexeme] = function;
+        methods[method->name.symbol()] = closure(method, method->name.lexeme() == "init");
     }
-    std::shared_ptr<LoxClass> superklass = nullptr;
-    if (superclass.type() == typeid(std::shared_ptr<LoxClass>)) 
+    Ref<LoxClass> superklass = nullptr;
+    if (superclass.isClass()) 
     {
-        superklass = std::any_cast<std::shared_ptr<LoxClass>>(superclass);
+        superklass = Ref<LoxClass>(superclass.asObject<LoxClass>());
     }
-    std::shared_ptr<LoxClass> klass = std::make_shared<LoxClass>(stmt->name.lexeme, superklass, methods);
+    Ref<LoxClass> klass = makeObject<LoxClass>(std::string(stmt.name.lexeme()), superklass, std::move(methods));
 
-    if (superklass != nullptr) 
+    if(stmt.superclass != nullptr)
     {
-      environment = environment->enclosing;
+        frame[stmt.superLocal.slot] = nullptr;
     }
-
-    environment->assign(stmt->name, klass);
-    return nullptr;
+    assign(stmt.local, stmt.name, klass);
 }
 
-std::any Interpreter::evaluate(std::shared_ptr<Expr> expr)
+// Creates a closure of `declaration`, capturing the boxes of the variables it
+// uses from the running call.
+Ref<LoxFunction> Interpreter::closure(Function* declaration, bool isInitializer)
 {
-    return expr->accept(*this);
-}
-
-bool Interpreter::isTruthy(std::any object)
-{
-    if(object.type() == typeid(nullptr))
-    {
-        return false;
-    }
-    if (object.type() == typeid(bool))
+    std::vector<Ref<LoxUpvalue>> captured;
+    captured.reserve(declaration->upvalues.size());
+    for(const UpvalueSlot& upvalue : declaration->upvalues)
     {
-        return std::any_cast<bool>(object);
+        if(upvalue.isLocal)
+        {
+            captured.emplace_back(frame[upvalue.index].asObject<LoxUpvalue>());
+        }
+        else
+        {
+            captured.push_back(upvalues[upvalue.index]);
+        }
     }
-    return true;
+    return makeObject<LoxFunction>(declaration, std::move(captured), isInitializer);
 }
 
-bool Interpreter::isEqual(const std::any &a, const std::any &b)
+LoxValue Interpreter::evaluate(Expr* expr)
 {
-    if (a.type() == typeid(nullptr) && b.type() == typeid(nullptr))
-    {
-        return true;
-    }
-
-    if (a.type() == typeid(nullptr))
-    {
-        return false;
-    }
-
-    if (a.type() == typeid(double) && b.type() == typeid(double))
-    {
-        return std::any_cast<double>(a) == std::any_cast<double>(b);
-    }
-
-    if (a.type() == typeid(std::string) && b.type() == typeid(std::string))
-    {
-        return std::any_cast<std::string>(a) == std::any_cast<std::string>(b);
-    }
-
-    if (a.type() == typeid(bool) && b.type() == typeid(bool))
-    {
-        return std::any_cast<bool>(a) == std::any_cast<bool>(b);
-    }
-
-    return false;
+    return expr->accept(*this);
 }
 
-void Interpreter::checkNumberOperand(Token op, std::any operand)
+void Interpreter::checkNumberOperand(const Token& op, const LoxValue& operand)
 {
-    if (operand.type() == typeid(double))
+    if (operand.isNumber())
     {
         return;
     }
     throw RuntimeError(op, "Operand must be a number.");
 }
 
-void Interpreter::checkNumberOperands(Token op, std::any left, std::any right)
+void Interpreter::checkNumberOperands(const Token& op, const LoxValue& left, const LoxValue& right)
 {
-    if (left.type() == typeid(double) && right.type() == typeid(double))
+    if (left.isNumber() && right.isNumber())
     {
         return;
     }
     throw RuntimeError(op, "Operands must be numbers.");
 }
 
-std::string Interpreter::stringify(std::any object)
+Completion Interpreter::execute(Stmt* stmt)
 {
-    if (object.type() == typeid(nullptr))
-        return "nil";
+    stmt->accept(*this);
+    return completion;
+}
 
-    if (object.type() == typeid(double))
+// Runs the body of `declaration` in a new frame, starting with the receiver
+// and the arguments.
+Completion Interpreter::executeCall(Function* declaration, const Ref<LoxUpvalue>* upvalues, LoxInstance* receiver, std::vector<LoxValue> arguments)
+{
+    if(frameTop + declaration->frameSize > frameStack.get() + FRAME_STACK_MAX)
     {
-        std::string text = std::to_string(std::any_cast<double>(object));
-        if (text.find('.') != std::string::npos)
-        {
-            text.erase(text.find_last_not_of('0') + 1, std::string::npos);
-            text.erase(text.find_last_not_of('.') + 1, std::string::npos);
-        }
-        return text;
+        throw RuntimeError(declaration->name, "Stack overflow.");
     }
 
-    if (object.type() == typeid(std::string))
-    {
-        return std::any_cast<std::string>(object);
-    }
+    FrameScope scope {*this, frame, this->upvalues};
+    frame = frameTop;
+    frameTop += declaration->frameSize;
+    this->upvalues = upvalues;
 
-    if (object.type() == typeid(bool))
+    int first = 0;
+    if(declaration->isMethod)
     {
-        return std::any_cast<bool>(object) ? "true" : "false";
+        frame[0] = receiver;
+        first = 1;
     }
-
-    if(object.type() == typeid(std::shared_ptr<LoxFunction>))
+    for(int i = 0; i < declaration->params.size(); i++) 
     {
-        return std::any_cast<std::shared_ptr<LoxFunction>>(object)->toString();
+        frame[first + i] = std::move(arguments[i]);
     }
-
-    if(object.type() == typeid(std::shared_ptr<LoxClass>))
+    for(int slot : declaration->boxedSlots)
     {
-        return std::any_cast<std::shared_ptr<LoxClass>>(object)->toString();
+        frame[slot] = makeObject<LoxUpvalue>(std::move(frame[slot]));
     }
 
-    if(object.type() == typeid(std::shared_ptr<LoxInstance>))
+    for(Stmt* statement : declaration->body)
     {
-        return std::any_cast<std::shared_ptr<LoxInstance>>(object)->toString();
+        if(execute(statement) == Completion::RETURN)
+        {
+            return Completion::RETURN;
+        }
     }
-
-    return "Unknown value";
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(std::shared_ptr<Stmt> stmt)
+Interpreter::FrameScope::~FrameScope()
 {
-    stmt->accept(*this);
+    std::fill(interpreter.frame, interpreter.frameTop, nullptr);
+    interpreter.frameTop = interpreter.frame;
+    interpreter.frame = previousFrame;
+    interpreter.upvalues = previousUpvalues;
 }
 
-void Interpreter::executeBlock(std::vector<std::shared_ptr<Stmt>> statements, std::shared_ptr<Environment> environment)
+LoxValue Interpreter::takeReturnValue()
 {
-    std::shared_ptr<Environment> previous = this->environment;
-
-    try
-    {
-        this->environment = environment;
+    completion = Completion::NORMAL;
+    return std::move(returnValue);
+}
 
-        for(std::shared_ptr<Stmt> statement : statements)
-        {
-            execute(statement);
-        }
-    }
-    catch(...)
+LoxValue Interpreter::lookUpVariable(const Token& name, const LocalSlot& local)
+{
+    switch(local.kind)
     {
-        this->environment = previous;
-        throw;
+    case LocalSlot::Kind::FRAME:
+        return frame[local.slot];
+    case LocalSlot::Kind::BOXED:
+        return frame[local.slot].asObject<LoxUpvalue>()->value;
+    case LocalSlot::Kind::UPVALUE:
+        return upvalues[local.slot]->value;
+    default:
+        return globals.get(name);
     }
-    this->environment = previous;
 }
 
-std::any Interpreter::lookUpVariable(Token& name, std::shared_ptr<Expr> expr)
+// Starts the lifetime of a variable. A boxed local gets a new box, so
+// closures made in an earlier iteration keep the value they saw.
+void Interpreter::define(const LocalSlot& local, const Token& name, LoxValue value)
 {
-    auto elem = locals.find(expr);
-    if(elem != locals.end())
+    switch(local.kind)
     {
-        int distance = elem->second;
-        return environment->getAt(distance, name.lexeme);
+    case LocalSlot::Kind::FRAME:
+        frame[local.slot] = std::move(value);
+        break;
+    case LocalSlot::Kind::BOXED:
+        frame[local.slot] = makeObject<LoxUpvalue>(std::move(value));
+        break;
+    default:
+        globals.define(name.symbol(), std::move(value));
+        break;
     }
-    else 
+}
+
+void Interpreter::assign(const LocalSlot& local, const Token& name, LoxValue value)
+{
+    switch(local.kind)
     {
-        return globals->get(name);
+    case LocalSlot::Kind::FRAME:
+        frame[local.slot] = std::move(value);
+        break;
+    case LocalSlot::Kind::BOXED:
+        frame[local.slot].asObject<LoxUpvalue>()->value = std::move(value);
+        break;
+    case LocalSlot::Kind::UPVALUE:
+        upvalues[local.slot]->value = std::move(value);
+        break;
+    default:
+        globals.assign(name, std::move(value));
+        break;
     }
-}
\ No newline at end of file
+}
@@ -1,60 +1,183 @@
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include "headers/Errors.hpp"
 #include "headers/Lox.hpp"
 #include "headers/Scanner.hpp"
+#include "headers/ScannerThread.hpp"
 #include "headers/Parser.hpp"
 #include "headers/AstPrinter.hpp"
 #include "headers/Interpreter.hpp"
 #include "headers/Resolver.hpp"
+#include "headers/Compiler.hpp"
+#include "headers/VM.hpp"
+#include "headers/AstArena.hpp"
+#include "headers/Source.hpp"
 
-TWI::Lox::Lox()
+TWI::Lox::Lox(Backend backend, bool streaming, bool scanThread) : backend {backend}, streaming {streaming}, scanThread {scanThread}
 {
     hadError = false;
 }
 
 Interpreter interpreter{};
+VM vm{};
+// Functions and classes the interpreter keeps in its variables point into
+// the AST they were declared in, so the nodes of every executed program that
+// declared one stay alive, and with them the source text their tokens view. A
+// streaming run keeps only the declarations that declared functions.
+std::vector<std::unique_ptr<AstArena>> programs;
+std::vector<std::unique_ptr<Source>> sources;
+
+static std::unique_ptr<TokenSource> scan(const Source& source, bool onThread)
+{
+    if(onThread)
+    {
+        return std::make_unique<ScannerThread>(source);
+    }
+    return std::make_unique<Scanner>(source);
+}
 
 void TWI::Lox::run(std::string source)
 {
-    Scanner scanner{source};
-    std::vector<Token> tokens = scanner.scanTokens();
-    Parser parser{tokens};
-    std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
+    std::unique_ptr<Source> text;
+    try
+    {
+        text = std::make_unique<Source>(std::move(source));
+    }
+    catch(const std::length_error& error)
+    {
+        std::cerr << error.what() << std::endl;
+        hadError = true;
+        return;
+    }
+    run(std::move(text));
+}
+
+void TWI::Lox::run(std::unique_ptr<Source> source)
+{
+    if(streaming)
+    {
+        runStreaming(std::move(source));
+        return;
+    }
+
+    std::unique_ptr<TokenSource> tokens = scan(*source, scanThread);
+    std::unique_ptr<AstArena> arena = std::make_unique<AstArena>();
+    Parser parser{*tokens, *arena};
+    std::vector<Stmt*> statements = parser.parse();
 
     if(hadError) return;
 
     // std::cout << "All good before resolving" << std::endl;
 
-    Resolver resolver{interpreter};
+    Resolver resolver;
     resolver.resolve(statements);
 
     // std::cout << "All good after resolving" << std::endl;
 
     if(hadError) return;
 
-    interpreter.interpret(statements);
-}
+    if(backend == Backend::BYTECODE_VM)
+    {
+        Compiler compiler{vm};
+        Ref<VMFunction> script = compiler.compile(statements);
 
-std::string TWI::Lox::readFile(std::string path)
-{
-    std::ifstream file{path, std::ios::in | std::ios::binary | std::ios::ate};
+        if(hadError) return;
 
-    if (!file)
-    {
-        std::cerr << "Could not open file " << path << std::endl;
-        exit(74);
+        vm.interpret(script);
+        return;
     }
 
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    interpreter.interpret(statements, resolver.scriptFrameSize());
+    if(parser.functionCount() > 0)
+    {
+        programs.push_back(std::move(arena));
+        sources.push_back(std::move(source));
+    }
+}
 
-    std::string contents(size, '\0');
-    file.read(&contents[0], size);
+// Each declaration is parsed into an arena of its own, and the arena is
+// cleared for the next one once the declaration has run, unless it declared
+// a function or class the interpreter may still hold. After a compile error
+// nothing more runs, but the rest of the program is still checked, and the
+// errors are reported as a batch run would report them: lexical errors as
+// they are found, then syntax errors, and only if there are none of those,
+// resolution errors, or failing that errors from the bytecode compiler. A
+// runtime error ends the run.
+void TWI::Lox::runStreaming(std::unique_ptr<Source> source)
+{
+    std::unique_ptr<TokenSource> tokens = scan(*source, scanThread);
+    std::unique_ptr<AstArena> arena = std::make_unique<AstArena>();
+    Parser parser{*tokens, *arena};
+    Resolver resolver;
+    std::vector<std::string> resolveErrors;
+    std::vector<std::string> compileErrors;
+    bool retained = false;
+    // A runtime error ends this run only, not later ones in the same REPL.
+    hadRuntimeError = false;
+
+    while(!parser.isAtEnd() && !hadRuntimeError)
+    {
+        size_t functions = parser.functionCount();
+        std::vector<Stmt*> statements {parser.parseDeclaration(*arena)};
+        bool retain = false;
+
+        if(hadError || parser.hadSyntaxError())
+        {
+            arena->clear();
+            continue;
+        }
+
+        heldErrors = &resolveErrors;
+        resolver.resolve(statements);
+        heldErrors = nullptr;
+
+        if(!resolveErrors.empty())
+        {
+            arena->clear();
+            continue;
+        }
+
+        if(backend == Backend::BYTECODE_VM)
+        {
+            Compiler compiler{vm};
+            heldErrors = &compileErrors;
+            Ref<VMFunction> script = compiler.compile(statements);
+            heldErrors = nullptr;
+
+            if(compileErrors.empty())
+            {
+                vm.interpret(script);
+            }
+        }
+        else
+        {
+            interpreter.interpret(statements, resolver.scriptFrameSize());
+            retain = parser.functionCount() != functions;
+        }
+
+        if(retain)
+        {
+            programs.push_back(std::move(arena));
+            arena = std::make_unique<AstArena>();
+            retained = true;
+        }
+        else
+        {
+            arena->clear();
+        }
+    }
 
-    file.close();
+    parser.reportErrors();
+    if(!hadError)
+    {
+        reportHeld(resolveErrors.empty() ? compileErrors : resolveErrors);
+    }
 
-    return contents;
+    if(retained)
+    {
+        sources.push_back(std::move(source));
+    }
 }
 
 void TWI::Lox::runPrompt()
@@ -66,16 +189,31 @@ void TWI::Lox::runPrompt()
         std::getline(std::cin, line);
         if (line.empty())
             break;
-        run(line.c_str());
+        run(line);
         hadError = false;
     }
 }
 
 void TWI::Lox::runFile(std::string path)
 {
-    std::string contents = readFile(path);
+    std::unique_ptr<Source> source;
+    try
+    {
+        source = Source::open(path);
+    }
+    catch(const std::length_error& error)
+    {
+        std::cerr << error.what() << std::endl;
+        exit(65);
+    }
+
+    if (source == nullptr)
+    {
+        std::cerr << "Could not open file " << path << std::endl;
+        exit(74);
+    }
 
-    run(contents.c_str());
+    run(std::move(source));
 
     if (hadError)
     {
@@ -1,13 +1,30 @@
 #include "./headers/LoxClass.hpp"
 
+static const Ref<LoxString> INIT = LoxString::intern("init");
+
 std::string LoxClass::toString()
 {
     return name;
 }
 
+void LoxClass::trace(Tracer& tracer)
+{
+    tracer.visit(superclass.get());
+    for(auto& entry : methods)
+    {
+        tracer.visit(entry.second.get());
+    }
+}
+
+void LoxClass::clearReferences()
+{
+    superclass = nullptr;
+    methods.clear();
+}
+
 int LoxClass::arity()
 {
-    std::shared_ptr<LoxFunction> initializer = findMethod("init");
+    LoxFunction* initializer = findMethod(INIT);
     if(initializer == nullptr) 
     {
         return 0;
@@ -15,23 +32,23 @@ int LoxClass::arity()
     return initializer->arity();
 }
 
-std::any LoxClass::call(Interpreter& interpreter, std::vector<std::any> arguments)
+LoxValue LoxClass::call(Interpreter& interpreter, std::vector<LoxValue> arguments)
 {
-    std::shared_ptr<LoxInstance> instance = std::make_shared<LoxInstance>(shared_from_this());
-    std::shared_ptr<LoxFunction> initializer = findMethod("init");
+    Ref<LoxInstance> instance = LoxInstance::create(Ref<LoxClass>(this));
+    LoxFunction* initializer = findMethod(INIT);
     if(initializer != nullptr)
     {
-        initializer->bind(instance)->call(interpreter, arguments);
+        initializer->invoke(interpreter, instance.get(), std::move(arguments));
     }
     return instance;
 }
 
-std::shared_ptr<LoxFunction> LoxClass::findMethod(std::string name)
+LoxFunction* LoxClass::findMethod(const Ref<LoxString>& name)
 {
     auto elem = methods.find(name);
     if(elem != methods.end())
     {
-        return elem->second;
+        return elem->second.get();
     }
 
     if(superclass != nullptr)
@@ -40,4 +57,4 @@ std::shared_ptr<LoxFunction> LoxClass::findMethod(std::string name)
     }
 
     return nullptr;
-}
\ No newline at end of file
+}
@@ -1,7 +1,7 @@
 #include "./headers/LoxFunction.hpp"
 #include "./headers/Interpreter.hpp"
 
-LoxFunction::LoxFunction(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure, bool isInitializer) : declaration {std::move(declaration)}, closure {std::move(closure)}, isInitializer {std::move(isInitializer)} {};
+LoxFunction::LoxFunction(Function* declaration, std::vector<Ref<LoxUpvalue>> upvalues, bool isInitializer, Ref<LoxInstance> receiver) : LoxCallable {ObjectType::FUNCTION}, declaration {std::move(declaration)}, upvalues {std::move(upvalues)}, isInitializer {std::move(isInitializer)}, receiver {std::move(receiver)} {};
 
 int LoxFunction::arity()
 {
@@ -10,37 +10,46 @@ int LoxFunction::arity()
 
 std::string LoxFunction::toString()
 {
-    return "<fn " + declaration->name.lexeme + ">";
+    return "<fn " + std::string(declaration->name.lexeme()) + ">";
 }
 
-std::any LoxFunction::call(Interpreter& interpreter, std::vector<std::any> arguments)
+void LoxFunction::trace(Tracer& tracer)
 {
-    auto environment = std::make_shared<Environment>(closure);
-    for(int i = 0; i < declaration->params.size(); i++) 
+    for(const Ref<LoxUpvalue>& upvalue : upvalues)
     {
-        environment->define(declaration->params[i].lexeme, arguments[i]);
+        tracer.visit(upvalue.get());
     }
-    try {
-        interpreter.executeBlock(declaration->body, environment);
-    } catch (LoxReturn &returnValue) {
-        if(isInitializer)
-        {
-            return closure->getAt(0, "this");
-        }
-        return returnValue.value;
+    tracer.visit(receiver.get());
+}
+
+void LoxFunction::clearReferences()
+{
+    upvalues.clear();
+    receiver = nullptr;
+}
+
+LoxValue LoxFunction::call(Interpreter& interpreter, std::vector<LoxValue> arguments)
+{
+    return invoke(interpreter, receiver.get(), std::move(arguments));
+}
+
+LoxValue LoxFunction::invoke(Interpreter& interpreter, LoxInstance* receiver, std::vector<LoxValue> arguments)
+{
+    LoxValue value = nullptr;
+    if(interpreter.executeCall(declaration, upvalues.data(), receiver, std::move(arguments)) == Completion::RETURN)
+    {
+        value = interpreter.takeReturnValue();
     }
 
     if(isInitializer) 
     {
-        return closure->getAt(0, "this");
+        return receiver;
     }
     
-    return nullptr;
+    return value;
 }
 
-std::shared_ptr<LoxFunction> LoxFunction::bind(std::shared_ptr<LoxInstance> instance)
+Ref<LoxFunction> LoxFunction::bind(LoxInstance* instance)
 {
-    std::shared_ptr<Environment> environment = std::make_shared<Environment>(closure);
-    environment->define("this", instance);
-    return std::make_shared<LoxFunction>(declaration, environment, isInitializer);
-}
\ No newline at end of file
+    return makeObject<LoxFunction>(declaration, upvalues, isInitializer, Ref<LoxInstance>(instance));
+}
@@ -1,31 +1,139 @@
 #include "./headers/LoxInstance.hpp"
 
+#include <algorithm>
+
+static_assert(sizeof(LoxInstance) % alignof(LoxValue) == 0, "inline fields must be aligned");
+
+// Upper bound on inline slots, so one instance used as a large dictionary
+// does not inflate every later instance of its class.
+static constexpr int MAX_INLINE_FIELDS = 16;
+
+static_assert(sizeof(LoxInstance) + MAX_INLINE_FIELDS * sizeof(LoxValue) <= Heap::MAX_SMALL_SIZE, "instances must come from the Heap's size classes");
+
+Ref<LoxInstance> LoxInstance::create(Ref<LoxClass> klass)
+{
+    uint32_t inlineCapacity = std::min(klass->fieldCapacity, MAX_INLINE_FIELDS);
+    return Ref<LoxInstance>(new(InlineFields {inlineCapacity}) LoxInstance(std::move(klass), inlineCapacity));
+}
+
+LoxInstance::LoxInstance(Ref<LoxClass> klass, uint32_t inlineCapacity) : LoxObject {ObjectType::INSTANCE}, klass {std::move(klass)}, shape {&this->klass->rootShape}, capacity {inlineCapacity}, inlineCapacity {inlineCapacity}
+{
+    fields = reinterpret_cast<LoxValue*>(this + 1);
+    std::uninitialized_default_construct_n(fields, inlineCapacity);
+}
+
+LoxInstance::~LoxInstance()
+{
+    std::destroy_n(reinterpret_cast<LoxValue*>(this + 1), inlineCapacity);
+    if(spilled != nullptr)
+    {
+        Heap::shrink(capacity * sizeof(LoxValue));
+    }
+}
 
 std::string LoxInstance::toString()
 {
     return klass->name + " instance";
 }
 
-std::any LoxInstance::get(Token& name)
+void LoxInstance::lookUp(const Token& name, PropertyCache& cache)
 {
-    auto elem = fields.find(name.lexeme);
-    if(elem != fields.end())
+    if(cache.shape != shape)
     {
-        return elem->second;
+        cache.klass = Ref<LoxObject>(klass.get());
+        cache.shape = shape;
+        cache.field = shape->find(name.symbol());
+        cache.transition = nullptr;
+        cache.method = cache.field < 0 ? klass->findMethod(name.symbol()) : nullptr;
     }
+}
 
-    std::shared_ptr<LoxFunction> method = klass->findMethod(name.lexeme);
-    if(method != nullptr) 
+void LoxInstance::trace(Tracer& tracer)
+{
+    tracer.visit(klass.get());
+    for(uint32_t i = 0; i < capacity; i++)
     {
-        return method->bind(shared_from_this());
+        tracer.visit(fields[i]);
     }
+}
 
-    throw RuntimeError(name, "Undefined property '" + name.lexeme + "'.");
+void LoxInstance::clearReferences()
+{
+    klass = nullptr;
+    for(uint32_t i = 0; i < capacity; i++)
+    {
+        fields[i] = nullptr;
+    }
 }
 
+LoxValue LoxInstance::get(const Token& name, PropertyCache& cache)
+{
+    lookUp(name, cache);
+
+    if(cache.field >= 0)
+    {
+        return fields[cache.field];
+    }
 
-std::any LoxInstance::set(Token& name, std::any value)
+    if(cache.method != nullptr)
+    {
+        return cache.method->bind(this);
+    }
+
+    throw RuntimeError(name, "Undefined property '" + std::string(name.lexeme()) + "'.");
+}
+
+// The unbound method `name` resolves to, or null if it is a field or
+// undefined, in which case get() gives the answer.
+LoxFunction* LoxInstance::getMethod(const Token& name, PropertyCache& cache)
+{
+    lookUp(name, cache);
+    return cache.field < 0 ? cache.method : nullptr;
+}
+
+
+void LoxInstance::set(const Token& name, LoxValue value, PropertyCache& cache)
+{
+    if(cache.shape != shape)
+    {
+        cache.klass = Ref<LoxObject>(klass.get());
+        cache.shape = shape;
+        cache.field = shape->find(name.symbol());
+        cache.transition = cache.field < 0 ? shape->addField(name.symbol()) : nullptr;
+        cache.method = nullptr;
+    }
+
+    if(cache.field >= 0)
+    {
+        fields[cache.field] = std::move(value);
+        return;
+    }
+
+    addField(cache.transition, std::move(value));
+}
+
+void LoxInstance::addField(Shape* next, LoxValue value)
 {
-    fields[name.lexeme] = value;
-    return nullptr;
-}
\ No newline at end of file
+    if(next->fieldCount > capacity)
+    {
+        uint32_t grown = capacity < 2 ? 4 : capacity * 2;
+        std::unique_ptr<LoxValue[]> storage {new LoxValue[grown]};
+        std::move(fields, fields + shape->fieldCount, storage.get());
+        if(spilled != nullptr)
+        {
+            Heap::shrink(capacity * sizeof(LoxValue));
+        }
+        Heap::grow(grown * sizeof(LoxValue));
+        spilled = std::move(storage);
+        fields = spilled.get();
+        capacity = grown;
+    }
+
+    fields[shape->fieldCount] = std::move(value);
+    shape = next;
+
+    if(shape->fieldCount > klass->fieldCapacity)
+    {
+        klass->fieldCapacity = shape->fieldCount;
+    }
+}
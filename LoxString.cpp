@@ -0,0 +1,75 @@
+#include "./headers/LoxString.hpp"
+
+#include <unordered_map>
+
+// Keys view the characters of the string they map to. Never destroyed, so
+// strings still alive during static destruction can unregister themselves.
+static std::unordered_map<std::string_view, LoxString*>& strings()
+{
+    static auto* table = new std::unordered_map<std::string_view, LoxString*>();
+    return *table;
+}
+
+Ref<LoxString> LoxString::intern(std::string_view chars)
+{
+    auto& table = strings();
+    auto elem = table.find(chars);
+    if(elem != table.end())
+    {
+        return Ref<LoxString>(elem->second);
+    }
+
+    Ref<LoxString> string {new LoxString(std::string {chars}, true)};
+    table.emplace(string->buffer, string.get());
+    return string;
+}
+
+Ref<LoxString> LoxString::concat(LoxString* left, LoxString* right)
+{
+    // Interned buffers key the intern table and must not move.
+    LoxString* owner = left->base != nullptr ? left->base.get() : left;
+    if(!owner->interned && owner->buffer.size() == left->length)
+    {
+        std::string_view suffix = right->chars();
+        if(right == owner || right->base.get() == owner)
+        {
+            owner->buffer.append(std::string {suffix});
+        }
+        else
+        {
+            owner->buffer.append(suffix);
+        }
+        owner->accountBuffer();
+        return Ref<LoxString>(new LoxString(Ref<LoxString>(owner), left->length + right->length));
+    }
+
+    std::string chars;
+    chars.reserve(left->length + right->length);
+    chars.append(left->chars());
+    chars.append(right->chars());
+    return Ref<LoxString>(new LoxString(std::move(chars), false));
+}
+
+LoxString::~LoxString()
+{
+    if(interned)
+    {
+        strings().erase(buffer);
+    }
+    Heap::shrink(bufferBytes);
+}
+
+void LoxString::accountBuffer()
+{
+    // Short strings are stored inline.
+    size_t capacity = buffer.capacity() > std::string {}.capacity() ? buffer.capacity() : 0;
+    if(capacity > bufferBytes)
+    {
+        Heap::grow(capacity - bufferBytes);
+    }
+    else
+    {
+        Heap::shrink(bufferBytes - capacity);
+    }
+    bufferBytes = capacity;
+}
@@ -0,0 +1,53 @@
+#include "./headers/LoxValue.hpp"
+#include "./headers/LoxString.hpp"
+
+bool LoxValue::equals(const LoxValue& other) const
+{
+    if (type != other.type)
+    {
+        return false;
+    }
+
+    switch (type)
+    {
+    case Type::NIL:
+        return true;
+    case Type::BOOL:
+        return as.boolean == other.as.boolean;
+    case Type::NUMBER:
+        return as.number == other.as.number;
+    case Type::OBJECT:
+        if (isString() && other.isString())
+        {
+            return asObject<LoxString>()->equals(other.asObject<LoxString>());
+        }
+        return as.object == other.as.object;
+    }
+
+    return false;
+}
+
+std::string LoxValue::toString() const
+{
+    switch (type)
+    {
+    case Type::NIL:
+        return "nil";
+    case Type::BOOL:
+        return as.boolean ? "true" : "false";
+    case Type::NUMBER:
+    {
+        std::string text = std::to_string(as.number);
+        if (text.find('.') != std::string::npos)
+        {
+            text.erase(text.find_last_not_of('0') + 1, std::string::npos);
+            text.erase(text.find_last_not_of('.') + 1, std::string::npos);
+        }
+        return text;
+    }
+    case Type::OBJECT:
+        return as.object->toString();
+    }
+
+    return "Unknown value";
+}
@@ -1,156 +1,204 @@
 #include "./headers/Parser.hpp"
 
-Parser::Parser(std::vector<Token> tokens) : tokens{tokens} {}
+Parser::Parser(TokenSource& tokenSource, AstArena& arena) : tokenSource{tokenSource}, arena{&arena} {}
 
-std::vector<std::shared_ptr<Stmt>> Parser::parse()
+// The token looked at but never consumed still has a hold on its literal.
+Parser::~Parser()
 {
-    std::vector<std::shared_ptr<Stmt>> statements;
+    if(pulled && currentToken.literal != 0)
+    {
+        TokenLiterals::release(currentToken.literal);
+    }
+}
+
+std::vector<Stmt*> Parser::parse()
+{
+    std::vector<Stmt*> statements;
     while(!isAtEnd())
     {
-        statements.push_back(declaration());
+        statements.push_back(parseDeclaration(*arena));
     }
 
+    reportErrors();
     return statements;
 }
 
-std::shared_ptr<Expr> Parser::expression()
+Stmt* Parser::parseDeclaration(AstArena& arena)
 {
-    return assignment();
+    this->arena = &arena;
+    return declaration();
 }
 
-std::shared_ptr<Expr> Parser::assignment()
+void Parser::reportErrors()
 {
-    std::shared_ptr<Expr> expr = _or();
-
-    if(match(TokenType::EQUAL))
+    for(const SyntaxError& error : syntaxErrors)
     {
-        Token equals = previous();
-        std::shared_ptr<Expr> value = assignment();
-
-        if(Variable* e = dynamic_cast<Variable*>(expr.get()))
-        {
-            Token name = e->name;
-            return std::make_shared<Assign>(std::move(name), value);
-        }
-        else if(Get* get = dynamic_cast<Get*>(expr.get()))
-        {
-            return std::make_shared<Set>(get->object, get->name, value);
-        }
-
-        error(equals, "Invalid assignment target.");
+        report(error.line, error.where, error.message);
     }
-
-    return expr;
+    syntaxErrors.clear();
 }
 
-std::shared_ptr<Expr> Parser::equality()
+Expr* Parser::expression()
 {
-    std::shared_ptr<Expr> expr = comparison();
-
-    while (match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL))
-    {
-        Token opr = previous();
-        std::shared_ptr<Expr> right = comparison();
-        expr = std::make_shared<Binary>(expr, std::move(opr), right);
-    }
-
-    return expr;
+    return expression(Precedence::ASSIGNMENT);
 }
 
-std::shared_ptr<Expr> Parser::comparison()
+// Parses an expression whose operators all bind at least as tightly as
+// `precedence`: a prefix expression, then every infix or postfix operator
+// that qualifies, folded into the left operand one at a time. Operands of
+// binary operators recurse once with a higher precedence, rather than once
+// per level of the grammar.
+Expr* Parser::expression(Precedence precedence)
 {
-    std::shared_ptr<Expr> expr = term();
+    Expr* expr = prefix();
 
-    while (match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL))
+    for(;;)
     {
-        Token opr = previous();
-        std::shared_ptr<Expr> right = term();
-        expr = std::make_shared<Binary>(expr, std::move(opr), right);
-    }
+        Precedence infix = infixPrecedence(peek().type);
+        if(infix < precedence)
+        {
+            return expr;
+        }
 
-    return expr;
+        Token op = advance();
+        switch(op.type)
+        {
+        case TokenType::EQUAL:
+            expr = assignment(expr, op);
+            break;
+        case TokenType::LEFT_PAREN:
+            expr = finishCall(expr);
+            break;
+        case TokenType::DOT:
+            expr = arena->make<Get>(expr, consume(TokenType::IDENTIFIER, "Expect property name after '.'."));
+            break;
+        case TokenType::OR:
+        case TokenType::AND:
+            expr = arena->make<Logical>(expr, op, expression(tighter(infix)));
+            break;
+        default:
+            expr = arena->make<Binary>(expr, op, expression(tighter(infix)));
+            break;
+        }
+    }
 }
 
-std::shared_ptr<Expr> Parser::term()
+Parser::Precedence Parser::infixPrecedence(TokenType type)
 {
-    std::shared_ptr<Expr> expr = factor();
-
-    while (match(TokenType::PLUS, TokenType::MINUS))
+    switch(type)
     {
-        Token opr = previous();
-        std::shared_ptr<Expr> right = factor();
-        expr = std::make_shared<Binary>(expr, std::move(opr), right);
+    case TokenType::EQUAL:
+        return Precedence::ASSIGNMENT;
+    case TokenType::OR:
+        return Precedence::OR;
+    case TokenType::AND:
+        return Precedence::AND;
+    case TokenType::BANG_EQUAL:
+    case TokenType::EQUAL_EQUAL:
+        return Precedence::EQUALITY;
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+        return Precedence::COMPARISON;
+    case TokenType::PLUS:
+    case TokenType::MINUS:
+        return Precedence::TERM;
+    case TokenType::STAR:
+    case TokenType::SLASH:
+        return Precedence::FACTOR;
+    case TokenType::LEFT_PAREN:
+    case TokenType::DOT:
+        return Precedence::CALL;
+    default:
+        return Precedence::NONE;
     }
+}
 
-    return expr;
+// Left-associative operators take operands that bind one level tighter.
+Parser::Precedence Parser::tighter(Precedence precedence)
+{
+    return static_cast<Precedence>(static_cast<int>(precedence) + 1);
 }
 
-std::shared_ptr<Expr> Parser::factor()
+// Assignment is right-associative, and whether its left side is a valid
+// target is only known once it has been parsed.
+Expr* Parser::assignment(Expr* target, const Token& equals)
 {
-    std::shared_ptr<Expr> expr = unary();
+    Expr* value = expression(Precedence::ASSIGNMENT);
 
-    while (match(TokenType::STAR, TokenType::SLASH))
+    if(Variable* e = dynamic_cast<Variable*>(target))
     {
-        Token opr = previous();
-        std::shared_ptr<Expr> right = unary();
-        expr = std::make_shared<Binary>(expr, std::move(opr), right);
+        return arena->make<Assign>(e->name, value);
     }
-
-    return expr;
-}
-
-std::shared_ptr<Expr> Parser::unary()
-{
-    if (match(TokenType::BANG, TokenType::MINUS))
+    else if(Get* get = dynamic_cast<Get*>(target))
     {
-        Token opr = previous();
-        std::shared_ptr<Expr> right = unary();
-        return std::make_shared<Unary>(opr, right);
+        return arena->make<Set>(get->object, get->name, value);
     }
 
-    return call();
+    error(equals, "Invalid assignment target.");
+    return target;
 }
 
-std::shared_ptr<Expr> Parser::primary()
+Expr* Parser::prefix()
 {
-    if (match(TokenType::FALSE))
-        return std::make_shared<Literal>(false);
-    if (match(TokenType::TRUE))
-        return std::make_shared<Literal>(true);
-    if (match(TokenType::NIL))
-        return std::make_shared<Literal>(nullptr);
-
-    if (match(TokenType::NUMBER, TokenType::STRING))
+    switch(peek().type)
     {
-        return std::make_shared<Literal>(previous().literal);
-    }
-
-    if (match(TokenType::THIS))
+    case TokenType::FALSE:
+        advance();
+        return arena->make<Literal>(false);
+    case TokenType::TRUE:
+        advance();
+        return arena->make<Literal>(true);
+    case TokenType::NIL:
+        advance();
+        return arena->make<Literal>(nullptr);
+    case TokenType::NUMBER:
+        return arena->make<Literal>(number(advance()));
+    case TokenType::STRING:
+        return arena->make<Literal>(advance().symbol());
+    case TokenType::THIS:
+        return arena->make<This>(advance());
+    case TokenType::IDENTIFIER:
+        return arena->make<Variable>(advance());
+    case TokenType::LEFT_PAREN:
     {
-        return std::make_shared<This>(previous());
+        advance();
+        Expr* expr = expression();
+        consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
+        return arena->make<Grouping>(expr);
     }
-
-    if(match(TokenType::IDENTIFIER))
+    case TokenType::SUPER:
     {
-        return std::make_shared<Variable>(previous());
+        Token keyword = advance();
+        consume(TokenType::DOT, "Expect '.' after super.");
+        Token method = consume(TokenType::IDENTIFIER, "Expect superclass method name.");
+        return arena->make<Super>(keyword, method);
     }
-
-    if (match(TokenType::LEFT_PAREN))
+    case TokenType::BANG:
+    case TokenType::MINUS:
     {
-        std::shared_ptr<Expr> expr = expression();
-        consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
-        return std::make_shared<Grouping>(expr);
+        Token op = advance();
+        Expr* right = expression(Precedence::UNARY);
+        return arena->make<Unary>(op, right);
     }
+    default:
+        throw error(peek(), "Expect expression.");
+    }
+}
 
-    if (match(TokenType::SUPER))
+// Decodes a number literal in place, without copying the lexeme or going
+// through the locale.
+double Parser::number(const Token& token)
+{
+    double value = 0;
+    std::string_view text = token.lexeme();
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if(result.ec == std::errc::result_out_of_range)
     {
-        Token keyword = previous();
-        consume(TokenType::DOT, "Expect '.' after super.");
-        Token method = consume(TokenType::IDENTIFIER, "Expect superclass method name.");
-        return std::make_shared<Super>(keyword, method);
+        error(token, "Number literal out of range.");
     }
-
-    throw error(peek(), "Expect expression.");
+    return value;
 }
 
 Token Parser::consume(TokenType type, std::string message)
@@ -160,16 +208,10 @@ Token Parser::consume(TokenType type, std::string message)
     throw error(peek(), message);
 }
 
-Parser::ParseError Parser::error(Token token, std::string message)
+Parser::ParseError Parser::error(const Token& token, std::string message)
 {
-    if (token.type == TokenType::EoF)
-    {
-        report(token.line, " at end", message);
-    }
-    else
-    {
-        report(token.line, " at " + token.lexeme + "'", message);
-    }
+    std::string where = token.type == TokenType::EoF ? " at end" : " at " + std::string(token.lexeme()) + "'";
+    syntaxErrors.push_back(SyntaxError {token.line(), std::move(where), message});
     return ParseError(message);
 }
 
@@ -197,8 +239,12 @@ bool Parser::check(TokenType type)
 Token Parser::advance()
 {
     if (!isAtEnd())
-        current++;
-    return previous();
+    {
+        previousToken = currentToken;
+        pulled = false;
+        arena->keepLiteral(previousToken.literal);
+    }
+    return previousToken;
 }
 
 bool Parser::isAtEnd()
@@ -206,14 +252,19 @@ bool Parser::isAtEnd()
     return peek().type == TokenType::EoF;
 }
 
-Token Parser::peek()
+const Token& Parser::peek()
 {
-    return tokens[current];
+    if(!pulled)
+    {
+        currentToken = tokenSource.nextToken();
+        pulled = true;
+    }
+    return currentToken;
 }
 
 Token Parser::previous()
 {
-    return tokens[current - 1];
+    return previousToken;
 }
 
 void Parser::synchronize()
@@ -236,18 +287,20 @@ void Parser::synchronize()
         case TokenType::PRINT:
         case TokenType::RETURN:
             return;
+        default:
+            break;
         }
 
         advance();
     }
 }
 
-std::shared_ptr<Stmt> Parser::statement()
+Stmt* Parser::statement()
 {
     if (match(TokenType::PRINT))
         return printStatement();
     if (match(TokenType::LEFT_BRACE))
-        return std::make_shared<Block>(block());
+        return arena->make<Block>(block());
     if (match(TokenType::IF))
         return ifStatement();
     if (match(TokenType::WHILE))
@@ -263,21 +316,21 @@ std::shared_ptr<Stmt> Parser::statement()
     return expressionStatement();
 }
 
-std::shared_ptr<Stmt> Parser::printStatement()
+Stmt* Parser::printStatement()
 {
-    std::shared_ptr<Expr> value = expression();
+    Expr* value = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after value.");
-    return std::make_shared<Print>(value);
+    return arena->make<Print>(value);
 }
 
-std::shared_ptr<Stmt> Parser::expressionStatement()
+Stmt* Parser::expressionStatement()
 {
-    std::shared_ptr<Expr> expr = expression();
+    Expr* expr = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-    return std::make_shared<Expression>(expr);
+    return arena->make<Expression>(expr);
 }
 
-std::shared_ptr<Stmt> Parser::declaration()
+Stmt* Parser::declaration()
 {
     try
     {
@@ -294,23 +347,23 @@ std::shared_ptr<Stmt> Parser::declaration()
     }
 }
 
-std::shared_ptr<Stmt> Parser::varDeclaration()
+Stmt* Parser::varDeclaration()
 {
     Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
     
-    std::shared_ptr<Expr> initializer = nullptr;
+    Expr* initializer = nullptr;
     if(match(TokenType::EQUAL))
     {
         initializer = expression();
     }
 
     consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-    return std::make_shared<Var>(name, initializer);
+    return arena->make<Var>(name, initializer);
 }
 
-std::vector<std::shared_ptr<Stmt>> Parser::block()
+std::vector<Stmt*> Parser::block()
 {
-    std::vector<std::shared_ptr<Stmt>> statements;
+    std::vector<Stmt*> statements;
 
     while (!check(TokenType::RIGHT_BRACE) && !isAtEnd())
     {
@@ -321,66 +374,38 @@ std::vector<std::shared_ptr<Stmt>> Parser::block()
     return statements;
 }
 
-std::shared_ptr<Stmt> Parser::ifStatement()
+Stmt* Parser::ifStatement()
 {
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'if'.");
-    std::shared_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after if condition.");
 
-    std::shared_ptr<Stmt> thenBranch = statement();
-    std::shared_ptr<Stmt> elseBranch = nullptr;
+    Stmt* thenBranch = statement();
+    Stmt* elseBranch = nullptr;
 
     if(match(TokenType::ELSE))
     {
         elseBranch = statement();
     }
 
-    return std::make_shared<If>(condition, thenBranch, elseBranch);
+    return arena->make<If>(condition, thenBranch, elseBranch);
 }
 
-std::shared_ptr<Expr> Parser::_or()
-{
-    std::shared_ptr<Expr> expr = _and();
-
-    while(match(TokenType::OR))
-    {
-        Token op = previous();
-        std::shared_ptr<Expr> right = _and();
-        expr = std::make_shared<Logical>(expr, op, right);
-    }
-
-    return expr;
-}
-
-std::shared_ptr<Expr> Parser::_and()
-{
-    std::shared_ptr<Expr> expr = equality();
-
-    while(match(TokenType::AND))
-    {
-        Token op = previous();
-        std::shared_ptr<Expr> right = equality();
-        expr = std::make_shared<Logical>(expr, op, right);
-    }
-
-    return expr;
-}
-
-std::shared_ptr<Stmt> Parser::whileStatement()
+Stmt* Parser::whileStatement()
 {
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
-    std::shared_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
-    std::shared_ptr<Stmt> body = statement();
+    Stmt* body = statement();
 
-    return std::make_shared<While>(condition, body);
+    return arena->make<While>(condition, body);
 }
 
-std::shared_ptr<Stmt> Parser::forStatement()
+Stmt* Parser::forStatement()
 {
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'for'.");
 
-    std::shared_ptr<Stmt> initializer;
+    Stmt* initializer;
     if(match(TokenType::SEMICOLON))
     {
         initializer = nullptr;
@@ -394,39 +419,39 @@ std::shared_ptr<Stmt> Parser::forStatement()
         initializer = expressionStatement();
     }
 
-    std::shared_ptr<Expr> condition = nullptr;
+    Expr* condition = nullptr;
     if(!check(TokenType::SEMICOLON)) 
     {
         condition = expression();
     }
     consume(TokenType::SEMICOLON, "Expect ';' after loop condition.");
 
-    std::shared_ptr<Expr> increment = nullptr;
+    Expr* increment = nullptr;
     if(!check(TokenType::RIGHT_PAREN)) 
     {
         increment = expression();
     }
     consume(TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
 
-    std::shared_ptr<Stmt> body = statement();
+    Stmt* body = statement();
 
     if(increment != nullptr) 
     {
-        body = std::make_shared<Block>(
-            std::vector<std::shared_ptr<Stmt>> {
+        body = arena->make<Block>(
+            std::vector<Stmt*> {
                 body, 
-                std::make_shared<Expression>(increment)
+                arena->make<Expression>(increment)
             }
         );
     }
 
-    if(condition == nullptr) condition = std::make_shared<Literal>(true);
-    body = std::make_shared<While>(condition, body);
+    if(condition == nullptr) condition = arena->make<Literal>(true);
+    body = arena->make<While>(condition, body);
 
     if(initializer != nullptr) 
     {
-        body = std::make_shared<Block>(
-            std::vector<std::shared_ptr<Stmt>> {
+        body = arena->make<Block>(
+            std::vector<Stmt*> {
                 initializer,
                 body
             }
@@ -436,32 +461,9 @@ std::shared_ptr<Stmt> Parser::forStatement()
     return body;
 }
 
-std::shared_ptr<Expr> Parser::call()
-{
-    std::shared_ptr<Expr> expr = primary();
-    while(true) 
-    {
-        if(match(TokenType::LEFT_PAREN)) 
-        {
-            expr = finishCall(expr);
-        } 
-        else if(match(TokenType::DOT))
-        {
-            Token name = consume(TokenType::IDENTIFIER, "Expect property name after '.'.");
-            expr = std::make_shared<Get>(expr, name);
-        }
-        else 
-        {
-            break;
-        }
-    }
-
-    return expr;
-}
-
-std::shared_ptr<Expr> Parser::finishCall(std::shared_ptr<Expr> callee)
+Expr* Parser::finishCall(Expr* callee)
 {
-    std::vector<std::shared_ptr<Expr>> arguments;
+    std::vector<Expr*> arguments;
     if(!check(TokenType::RIGHT_PAREN)) 
     {
         do 
@@ -477,10 +479,12 @@ std::shared_ptr<Expr> Parser::finishCall(std::shared_ptr<Expr> callee)
 
     Token paren = consume(TokenType::RIGHT_PAREN, "Expect ')' after arguments.");
 
-    return std::make_shared<Call>(callee, paren, arguments);
+    Call* call = arena->make<Call>(callee, paren, std::move(arguments));
+    call->property = dynamic_cast<Get*>(callee);
+    return call;
 }
 
-std::shared_ptr<Function> Parser::function(std::string kind)
+Function* Parser::function(std::string kind)
 {
     Token name = consume(TokenType::IDENTIFIER, "Expect " + kind + " name.");
     consume(TokenType::LEFT_PAREN, "Expect '(' after " + kind + " name.");
@@ -501,37 +505,38 @@ std::shared_ptr<Function> Parser::function(std::string kind)
 
     consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body.");
 
-    std::vector<std::shared_ptr<Stmt>> body = block();
-    return std::make_shared<Function>(std::move(name), std::move(parameters), std::move(body));
+    std::vector<Stmt*> body = block();
+    functions++;
+    return arena->make<Function>(std::move(name), std::move(parameters), std::move(body));
 }
 
-std::shared_ptr<Stmt> Parser::returnStatement()
+Stmt* Parser::returnStatement()
 {
     Token keyword = previous();
-    std::shared_ptr<Expr> value = nullptr;
+    Expr* value = nullptr;
     if(!check(TokenType::SEMICOLON))
     {
         value = expression();
     }
     consume(TokenType::SEMICOLON, "Expect ';' after return value.");
 
-    return std::make_shared<Return>(keyword, value);
+    return arena->make<Return>(keyword, value);
 }
 
-std::shared_ptr<Stmt> Parser::classDeclaration()
+Stmt* Parser::classDeclaration()
 {
     Token name = consume(TokenType::IDENTIFIER, "Expect class name.");
 
-    std::shared_ptr<Variable> superclass = nullptr;
+    Variable* superclass = nullptr;
     if(match(TokenType::LESS))
     {
         consume(TokenType::IDENTIFIER, "Expect superclass name.");
-        superclass = std::make_shared<Variable>(previous());
+        superclass = arena->make<Variable>(previous());
     }
 
     consume(TokenType::LEFT_BRACE, "Expect '{' before class body");
 
-    std::vector<std::shared_ptr<Function>> methods;
+    std::vector<Function*> methods;
     while(!check(TokenType::RIGHT_BRACE) && !isAtEnd())
     {
         methods.push_back(function("method"));
@@ -539,5 +544,5 @@ std::shared_ptr<Stmt> Parser::classDeclaration()
     
     consume(TokenType::RIGHT_BRACE, "Expect '}' after class body.");
 
-    return std::make_shared<Class>(name, superclass, methods);
+    return arena->make<Class>(name, superclass, std::move(methods));
 }
\ No newline at end of file
@@ -1,121 +1,119 @@
 #include "./headers/Resolver.hpp"
 
-std::any Resolver::visitBlockStmt(std::shared_ptr<Block> stmt)
+#include <algorithm>
+
+void Resolver::visitBlockStmt(Block& stmt)
 {
     // std::cout << "In visitBlockStmt" << std::endl;
     beginScope();
     // std::cout << "Beginscope done" << std::endl;
-    resolve(stmt->statements);
+    resolve(stmt.statements);
     // std::cout << "resolve in visitBlockstmt done" << std::endl;
+    Scope& scope = scopes.back();
+    stmt.slotCount = scope.locals.size();
+    stmt.frameSlot = scope.frameBase;
     endScope();
     // std::cout << "Out visitBlockStmt" << std::endl;
-    return nullptr;
 }
 
-std::any Resolver::visitVarStmt(std::shared_ptr<Var> stmt)
+void Resolver::visitVarStmt(Var& stmt)
 {
-    declare(stmt->name);
-    if(stmt->initializer != nullptr)
+    declare(stmt.name);
+    bind(stmt.local, stmt.name.symbol().get());
+    if(stmt.initializer != nullptr)
     {
-        resolve(stmt->initializer);
+        resolve(stmt.initializer);
     }
-    define(stmt->name);
-    return nullptr;
+    define(stmt.name);
 }
 
-std::any Resolver::visitFunctionStmt(std::shared_ptr<Function> stmt)
+void Resolver::visitFunctionStmt(Function& stmt)
 {
-    declare(stmt->name);
-    define(stmt->name);
+    declare(stmt.name);
+    define(stmt.name);
+    bind(stmt.local, stmt.name.symbol().get());
 
-    resolveFunction(stmt, FunctionType::FUNCTION);
-    return nullptr;
+    resolveFunction(&stmt, FunctionType::FUNCTION);
 }
 
-std::any Resolver::visitVariableExpr(std::shared_ptr<Variable> expr)
+LoxValue Resolver::visitVariableExpr(Variable& expr)
 {
     if(!scopes.empty())
     {
-        auto& scope = scopes.back();
-        auto elem = scope.find(expr->name.lexeme);
-        if(elem != scope.end() && elem->second == false)
+        auto& locals = scopes.back().locals;
+        auto elem = locals.find(expr.name.symbol().get());
+        if(elem != locals.end() && !elem->second.defined)
         {
-            error(expr->name, "Can't read local variable in its own initializer.");
+            error(expr.name, "Can't read local variable in its own initializer.");
         }
     }
 
-    resolveLocal(expr, expr->name);
+    resolveLocal(expr.local, expr.name.symbol().get());
     return {};
 }
 
-std::any Resolver::visitAssignExpr(std::shared_ptr<Assign> expr)
+LoxValue Resolver::visitAssignExpr(Assign& expr)
 {
-    resolve(expr->value);
-    resolveLocal(expr, expr->name);
+    resolve(expr.value);
+    resolveLocal(expr.local, expr.name.symbol().get());
     return nullptr;
 }
 
-std::any Resolver::visitExpressionStmt(std::shared_ptr<Expression> stmt)
+void Resolver::visitExpressionStmt(Expression& stmt)
 {
-    resolve(stmt->expression);
-    return nullptr;
+    resolve(stmt.expression);
 }
 
-std::any Resolver::visitIfStmt(std::shared_ptr<If> stmt)
+void Resolver::visitIfStmt(If& stmt)
 {
-    resolve(stmt->condition);
-    resolve(stmt->thenBranch);
-    if(stmt->elseBranch != nullptr) 
+    resolve(stmt.condition);
+    resolve(stmt.thenBranch);
+    if(stmt.elseBranch != nullptr) 
     {
-        resolve(stmt->elseBranch);
+        resolve(stmt.elseBranch);
     }
-    return nullptr;
 }
 
-std::any Resolver::visitPrintStmt(std::shared_ptr<Print> stmt)
+void Resolver::visitPrintStmt(Print& stmt)
 {
-    resolve(stmt->expression);
-    return {};
+    resolve(stmt.expression);
 }
 
-std::any Resolver::visitReturnStmt(std::shared_ptr<Return> stmt)
+void Resolver::visitReturnStmt(Return& stmt)
 {
     if(currentFunction == FunctionType::NONE)
     {
-        error(stmt->keyword, "Can't return from top-level code.");
+        error(stmt.keyword, "Can't return from top-level code.");
     }
 
-    if(stmt->value != nullptr)
+    if(stmt.value != nullptr)
     {
         if(currentFunction == FunctionType::INITIALIZER)
         {
-            error(stmt->keyword, "Can't return a value from initializer.");
+            error(stmt.keyword, "Can't return a value from initializer.");
         }
-        resolve(stmt->value);
+        resolve(stmt.value);
     }
-
-    return nullptr;
 }
 
-std::any Resolver::visitWhileStmt(std::shared_ptr<While> stmt)
+void Resolver::visitWhileStmt(While& stmt)
 {
-    resolve(stmt->condition);
-    resolve(stmt->body);
-    return nullptr;
+    resolve(stmt.condition);
+    resolve(stmt.body);
 }
 
-std::any Resolver::visitBinaryExpr(std::shared_ptr<Binary> expr)
+LoxValue Resolver::visitBinaryExpr(Binary& expr)
 {
-    resolve(expr->left);
-    resolve(expr->right);
+    resolve(expr.left);
+    resolve(expr.right);
     return nullptr;
 }
 
-std::any Resolver::visitCallExpr(std::shared_ptr<Call> expr)
+LoxValue Resolver::visitCallExpr(Call& expr)
 {
-    resolve(expr->callee);
+    resolve(expr.callee);
 
-    for(std::shared_ptr<Expr> argument : expr->arguments)
+    for(Expr* argument : expr.arguments)
     {
         resolve(argument);
     }
@@ -123,157 +121,180 @@ std::any Resolver::visitCallExpr(std::shared_ptr<Call> expr)
     return nullptr;
 }
 
-std::any Resolver::visitGroupingExpr(std::shared_ptr<Grouping> expr)
+LoxValue Resolver::visitGroupingExpr(Grouping& expr)
 {
-    resolve(expr->expression);
+    resolve(expr.expression);
     return nullptr;
 }
 
-std::any Resolver::visitLiteralExpr(std::shared_ptr<Literal> expr)
+LoxValue Resolver::visitLiteralExpr(Literal& expr)
 {
     return nullptr;
 }
 
-std::any Resolver::visitLogicalExpr(std::shared_ptr<Logical> expr)
+LoxValue Resolver::visitLogicalExpr(Logical& expr)
 {
-    resolve(expr->left);
-    resolve(expr->right);
+    resolve(expr.left);
+    resolve(expr.right);
     return nullptr;
 }
 
-std::any Resolver::visitUnaryExpr(std::shared_ptr<Unary> expr)
+LoxValue Resolver::visitUnaryExpr(Unary& expr)
 {
-    resolve(expr->right);
+    resolve(expr.right);
     return nullptr;
 }
 
-std::any Resolver::visitClassStmt(std::shared_ptr<Class> stmt)
+void Resolver::visitClassStmt(Class& stmt)
 {
     ClassType enclosingClass = currentClass;
     currentClass = ClassType::CLASS;
-    declare(stmt->name);
-    define(stmt->name);
+    declare(stmt.name);
+    define(stmt.name);
+    bind(stmt.local, stmt.name.symbol().get());
 
-    if(stmt->superclass != nullptr && stmt->name.lexeme == stmt->superclass->name.lexeme)
+    if(stmt.superclass != nullptr && stmt.name.symbol() == stmt.superclass->name.symbol())
     {
-        error(stmt->superclass->name, "A class can't inherit from itself.");
+        error(stmt.superclass->name, "A class can't inherit from itself.");
     }
 
-    if(stmt->superclass != nullptr)
+    if(stmt.superclass != nullptr)
     {
         currentClass = ClassType::SUBCLASS;
-        resolve(stmt->superclass);
-        scopes.back()["super"] = true;
+        resolve(stmt.superclass);
+        beginScope();
+        declare(superSymbol.get());
+        bind(stmt.superLocal, superSymbol.get());
     }
 
-    beginScope();
-    scopes.back()["this"] = true;
-
-    for(std::shared_ptr<Function> method : stmt->methods)
+    for(Function* method : stmt.methods)
     {
         FunctionType declaration = FunctionType::METHOD;
-        if(method->name.lexeme == "init")
+        if(method->name.lexeme() == "init")
         {
             declaration = FunctionType::INITIALIZER;
         }
         resolveFunction(method, declaration);
     }
 
-    endScope();
-
-    if(stmt->superclass != nullptr) 
+    if(stmt.superclass != nullptr) 
     {
         endScope();
     }
 
     currentClass = enclosingClass;
-
-    return nullptr;
 }
 
-std::any Resolver::visitGetExpr(std::shared_ptr<Get> expr)
+LoxValue Resolver::visitGetExpr(Get& expr)
 {
-    resolve(expr->object);
+    resolve(expr.object);
     return nullptr;
 }
 
-std::any Resolver::visitSetExpr(std::shared_ptr<Set> expr)
+LoxValue Resolver::visitSetExpr(Set& expr)
 {
-    resolve(expr->value);
-    resolve(expr->object);
+    resolve(expr.value);
+    resolve(expr.object);
     return nullptr;
 }
 
-std::any Resolver::visitThisExpr(std::shared_ptr<This> expr)
+LoxValue Resolver::visitThisExpr(This& expr)
 {
     if(currentClass == ClassType::NONE)
     {
-        error(expr->keyword, "Can't use 'this' outside of a class.");
+        error(expr.keyword, "Can't use 'this' outside of a class.");
         return nullptr;
     }
-    resolveLocal(expr, expr->keyword);
+    resolveLocal(expr.local, thisSymbol.get());
     return nullptr;
 }
 
-std::any Resolver::visitSuperExpr(std::shared_ptr<Super> expr)
+LoxValue Resolver::visitSuperExpr(Super& expr)
 {
     if (currentClass == ClassType::NONE) {
-      error(expr->keyword,
+      error(expr.keyword,
           "Can't user 'super' outside of a class.");
     } else if (currentClass != ClassType::SUBCLASS) {
-      error(expr->keyword,
+      error(expr.keyword,
           "Can't user 'super' in a class with no superclass.");
     }
 
-    resolveLocal(expr, expr->keyword);
+    resolveLocal(expr.local, superSymbol.get());
+    resolveLocal(expr.thisLocal, thisSymbol.get());
     return nullptr;
 }
 
-void Resolver::resolve(std::vector<std::shared_ptr<Stmt>> statements)
+void Resolver::resolve(const std::vector<Stmt*>& statements)
 {
-    for(std::shared_ptr<Stmt> statement : statements) 
+    for(Stmt* statement : statements) 
     {
         // std::cout << "Resolvinggggg in Resolver::resolve" << std::endl;
         resolve(statement);
     }
 }
 
-void Resolver::resolve(std::shared_ptr<Stmt> stmt) 
+void Resolver::resolve(Stmt* stmt) 
 {
-    // std::cout << "in resolve(std::shared_ptr<Stmt> stmt)" << std::endl;
+    // std::cout << "in resolve(Stmt* stmt)" << std::endl;
     stmt->accept(*this);
 }
 
-void Resolver::resolve(std::shared_ptr<Expr> expr)
+void Resolver::resolve(Expr* expr)
 {
     expr->accept(*this);
 }
 
 void Resolver::beginScope()
 {
-    scopes.push_back(std::map<std::string, bool> {});
+    // Nested blocks of a function take the frame slots after those of the
+    // scopes around them.
+    int frameBase = 0;
+    if(!scopes.empty() && scopes.back().function == functions.size() - 1)
+    {
+        frameBase = scopes.back().frameBase + scopes.back().locals.size();
+    }
+    scopes.push_back(Scope {{}, int(functions.size() - 1), frameBase});
 }
 
 void Resolver::endScope()
 {
+    Scope& scope = scopes.back();
+    for(Reference& reference : scope.references)
+    {
+        reference.local->kind = reference.variable->captured ? LocalSlot::Kind::BOXED : LocalSlot::Kind::FRAME;
+        reference.local->slot = scope.frameBase + reference.variable->slot;
+    }
     scopes.pop_back();
 }
 
-void Resolver::declare(Token& name)
+int Resolver::declare(Token& name)
 {
     if(scopes.empty())
     {
-        return;
+        return -1;
     }
 
-    std::map<std::string, bool> scope = scopes.back();
+    auto& locals = scopes.back().locals;
 
-    if(scope.find(name.lexeme) != scope.end())
+    auto elem = locals.find(name.symbol().get());
+    if(elem != locals.end())
     {
         error(name, "Already a variable with this name in this scope.");
+        return elem->second.slot;
     }
 
-    scope[name.lexeme] = false;
+    int slot = declare(name.symbol().get());
+    locals[name.symbol().get()].defined = false;
+    return slot;
+}
+
+int Resolver::declare(const LoxString* name)
+{
+    Scope& scope = scopes.back();
+    int slot = scope.locals.size();
+    scope.locals.emplace(name, Local {slot, true});
+    frameSize = std::max(frameSize, scope.frameBase + slot + 1);
+    return slot;
 }
 
 void Resolver::define(Token& name)
@@ -282,34 +303,105 @@ void Resolver::define(Token& name)
     {
         return;
     }
-    scopes.back()[name.lexeme] = true;
+    scopes.back().locals[name.symbol().get()].defined = true;
 }
 
-void Resolver::resolveLocal(std::shared_ptr<Expr> expr, Token& name)
+// Records that `local` is the declaration of `name` in the innermost scope.
+void Resolver::bind(LocalSlot& local, const LoxString* name)
 {
+    if(!scopes.empty())
+    {
+        Scope& scope = scopes.back();
+        scope.references.push_back(Reference {&local, &scope.locals[name]});
+    }
+}
+
+void Resolver::resolveLocal(LocalSlot& local, const LoxString* name)
+{
+    int function = functions.size() - 1;
     for(int i = scopes.size() - 1; i >= 0; i--) 
     {
-        if(scopes[i].find(name.lexeme) != scopes[i].end())
+        auto elem = scopes[i].locals.find(name);
+        if(elem == scopes[i].locals.end())
         {
-            interpreter.resolve(expr, scopes.size() - 1 - i);
+            continue;
+        }
+
+        Local& variable = elem->second;
+        if(scopes[i].function == function)
+        {
+            scopes[i].references.push_back(Reference {&local, &variable});
             return;
         }
+
+        variable.captured = true;
+        local.kind = LocalSlot::Kind::UPVALUE;
+        local.slot = resolveUpvalue(function, scopes[i].function, scopes[i].frameBase + variable.slot);
+        return;
     }
 }
 
-void Resolver::resolveFunction(std::shared_ptr<Function> function, FunctionType type)
+// The upvalue of function `function` that reaches frame slot `frameSlot` of
+// the enclosing function `declaringFunction`, threading it through every
+// function in between.
+int Resolver::resolveUpvalue(int function, int declaringFunction, int frameSlot)
+{
+    if(function - 1 == declaringFunction)
+    {
+        return addUpvalue(functions[function], true, frameSlot);
+    }
+    int index = resolveUpvalue(function - 1, declaringFunction, frameSlot);
+    return addUpvalue(functions[function], false, index);
+}
+
+int Resolver::addUpvalue(Function* function, bool isLocal, int index)
+{
+    std::vector<UpvalueSlot>& upvalues = function->upvalues;
+    for(int i = 0; i < upvalues.size(); i++)
+    {
+        if(upvalues[i].isLocal == isLocal && upvalues[i].index == index)
+        {
+            return i;
+        }
+    }
+    upvalues.push_back(UpvalueSlot {isLocal, index});
+    return upvalues.size() - 1;
+}
+
+void Resolver::resolveFunction(Function* function, FunctionType type)
 {
     FunctionType enclosingFunction = currentFunction;
+    int enclosingFrameSize = frameSize;
     currentFunction = type;
+    functions.push_back(function);
+    frameSize = 0;
 
     beginScope();
+    if(type == FunctionType::METHOD || type == FunctionType::INITIALIZER)
+    {
+        function->isMethod = true;
+        declare(thisSymbol.get());
+    }
     for(Token& param : function->params)
     {
         declare(param);
         define(param);
     }
     resolve(function->body);
+
+    // The receiver and parameters are the first locals of the function scope.
+    for(auto& entry : scopes.back().locals)
+    {
+        const Local& variable = entry.second;
+        if(variable.captured && variable.slot < function->params.size() + (function->isMethod ? 1 : 0))
+        {
+            function->boxedSlots.push_back(variable.slot);
+        }
+    }
     endScope();
+    function->frameSize = frameSize;
 
+    functions.pop_back();
+    frameSize = enclosingFrameSize;
     currentFunction = enclosingFunction;
-}
\ No newline at end of file
+}
@@ -1,16 +1,109 @@
 #include "./headers/Scanner.hpp"
 #include "./headers/Errors.hpp"
 
-Scanner::Scanner() : source{""} 
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LOX_SCAN_SIMD 1
+#endif
+
+// The skip functions below consume runs of whitespace and identifier
+// characters 16 bytes per step where SSE2 is available. A vector
+// step needs 16 readable bytes, so the last few bytes of the source, and all
+// of it on other targets, go through the scalar loop after it.
+#ifdef LOX_SCAN_SIMD
+static constexpr int VECTOR_SIZE = 16;
+
+static __m128i load(const char* bytes)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+}
+
+static __m128i equals(__m128i chunk, char c)
+{
+    return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+}
+
+// Bytes in [low, high]. Signed compares are fine for ASCII bounds: bytes
+// above 0x7f compare as negative and fall outside.
+static __m128i inRange(__m128i chunk, char low, char high)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1)));
+}
+#endif
+
+// The keyword `text` spells, or IDENTIFIER: a switch on the leading
+// characters picks the only keyword it could be, and one comparison of the
+// remaining characters decides. There is no table to build per Scanner.
+static constexpr TokenType checkKeyword(std::string_view text, size_t start, std::string_view rest, TokenType type)
 {
-    initialiseKeywords();
+    return text.substr(start) == rest ? type : TokenType::IDENTIFIER;
 }
 
-Scanner::Scanner(std::string source) : source{source} 
+static constexpr TokenType keywordType(std::string_view text)
 {
-    initialiseKeywords();
+    switch(text[0])
+    {
+    case 'a':
+        return checkKeyword(text, 1, "nd", TokenType::AND);
+    case 'c':
+        return checkKeyword(text, 1, "lass", TokenType::CLASS);
+    case 'e':
+        return checkKeyword(text, 1, "lse", TokenType::ELSE);
+    case 'f':
+        if(text.length() > 1)
+        {
+            switch(text[1])
+            {
+            case 'a':
+                return checkKeyword(text, 2, "lse", TokenType::FALSE);
+            case 'o':
+                return checkKeyword(text, 2, "r", TokenType::FOR);
+            case 'u':
+                return checkKeyword(text, 2, "n", TokenType::FUN);
+            }
+        }
+        break;
+    case 'i':
+        return checkKeyword(text, 1, "f", TokenType::IF);
+    case 'n':
+        return checkKeyword(text, 1, "il", TokenType::NIL);
+    case 'o':
+        return checkKeyword(text, 1, "r", TokenType::OR);
+    case 'p':
+        return checkKeyword(text, 1, "rint", TokenType::PRINT);
+    case 'r':
+        return checkKeyword(text, 1, "eturn", TokenType::RETURN);
+    case 's':
+        return checkKeyword(text, 1, "uper", TokenType::SUPER);
+    case 't':
+        if(text.length() > 1)
+        {
+            switch(text[1])
+            {
+            case 'h':
+                return checkKeyword(text, 2, "is", TokenType::THIS);
+            case 'r':
+                return checkKeyword(text, 2, "ue", TokenType::TRUE);
+            }
+        }
+        break;
+    case 'v':
+        return checkKeyword(text, 1, "ar", TokenType::VAR);
+    case 'w':
+        return checkKeyword(text, 1, "hile", TokenType::WHILE);
+    }
+    return TokenType::IDENTIFIER;
 }
 
+static_assert(keywordType("class") == TokenType::CLASS && keywordType("false") == TokenType::FALSE && keywordType("this") == TokenType::THIS, "keywords must be recognized");
+static_assert(keywordType("f") == TokenType::IDENTIFIER && keywordType("classy") == TokenType::IDENTIFIER && keywordType("th") == TokenType::IDENTIFIER, "prefixes and extensions of keywords are identifiers");
+
+Scanner::Scanner(const Source& source) : source{source.text()}, base{source.start()} {}
+
+Scanner::Scanner(const Source& source, bool detached) : source{source.text()}, base{source.start()}, detached{detached} {}
+
 std::vector<Token> Scanner::scanTokens()
 {
     while (!isAtEnd())
@@ -19,9 +112,34 @@ std::vector<Token> Scanner::scanTokens()
         scanToken();
     }
 
-    tokens.push_back(Token(TokenType::EoF, "", NULL, line));
+    tokens.push_back(endOfFile());
+
+    return std::move(tokens);
+}
+
+Token Scanner::nextToken()
+{
+    // A call to scanToken adds at most one token, and none for whitespace,
+    // comments or a lexical error.
+    while (tokens.empty() && !isAtEnd())
+    {
+        start = current;
+        scanToken();
+    }
+
+    if (tokens.empty())
+    {
+        return endOfFile();
+    }
 
-    return tokens;
+    Token token = std::move(tokens.back());
+    tokens.pop_back();
+    return token;
+}
+
+Token Scanner::endOfFile()
+{
+    return Token {TokenType::EoF, static_cast<uint32_t>(base + source.length()), 0, 0};
 }
 
 bool Scanner::isAtEnd()
@@ -79,10 +197,7 @@ void Scanner::scanToken()
     case '/':
         if(match('/'))
         {
-            while(peek() != '\n' && !isAtEnd())
-            {
-                advance();
-            }
+            skipComment();
         }
         else
         {
@@ -92,9 +207,8 @@ void Scanner::scanToken()
     case ' ':
     case '\r':
     case '\t':
-        break;
     case '\n':
-        line++;
+        skipWhitespace();
         break;
     case '"':
         _string();
@@ -111,7 +225,7 @@ void Scanner::scanToken()
         }
         else 
         {
-            error(line, "Unexpected character.");
+            lexicalError(LexicalError::UNEXPECTED_CHARACTER);
         }
         break;
     }
@@ -122,15 +236,37 @@ char Scanner::advance()
     return source[current++];
 }
 
-void Scanner::addToken(TokenType type)
+void Scanner::addToken(TokenType type, uint32_t literal)
 {
-    addToken(type, NULL);
+    tokens.push_back(Token {type, base + start, static_cast<uint32_t>(current - start), literal});
 }
 
-void Scanner::addToken(TokenType type, std::any literal)
+void Scanner::addSymbol(TokenType type, std::string_view text)
 {
-    std::string text = source.substr(start, current - start);
-    tokens.push_back(Token(type, text, literal, line));
+    addToken(type, detached ? 0 : TokenLiterals::add(LoxString::intern(text)));
+}
+
+const char* Scanner::errorMessage(LexicalError error)
+{
+    switch(error)
+    {
+    case LexicalError::UNEXPECTED_CHARACTER:
+        return "Unexpected character.";
+    case LexicalError::UNTERMINATED_STRING:
+        return "Unterminated string.";
+    }
+    return "";
+}
+
+// The error is reported at the line the scanned text so far ends on.
+void Scanner::lexicalError(LexicalError error)
+{
+    if(detached)
+    {
+        addToken(TokenType::ERROR, static_cast<uint32_t>(error));
+        return;
+    }
+    ::error(Source::at(base).line(base + current), errorMessage(error));
 }
 
 bool Scanner::match(char expected)
@@ -157,27 +293,85 @@ char Scanner::peek()
     return source[current];
 }
 
-void Scanner::_string()
+void Scanner::skipWhitespace()
 {
-    while(peek() != '"' && !isAtEnd())
+#ifdef LOX_SCAN_SIMD
+    while(current + VECTOR_SIZE <= source.length())
+    {
+        __m128i chunk = load(source.data() + current);
+        __m128i blanks = _mm_or_si128(_mm_or_si128(equals(chunk, ' '), equals(chunk, '\t')), _mm_or_si128(equals(chunk, '\r'), equals(chunk, '\n')));
+        unsigned others = ~_mm_movemask_epi8(blanks) & 0xffff;
+        if(others != 0)
+        {
+            current += __builtin_ctz(others);
+            return;
+        }
+        current += VECTOR_SIZE;
+    }
+#endif
+
+    for(; !isAtEnd(); current++)
     {
-        if(peek() == '\n')
+        char c = source[current];
+        if(c != ' ' && c != '\t' && c != '\r' && c != '\n')
         {
-            line++;
+            return;
         }
+    }
+}
+
+// Up to the newline ending a `//` comment; memchr is vectorized already.
+void Scanner::skipComment()
+{
+    const void* newline = std::memchr(source.data() + current, '\n', source.length() - current);
+    current = newline != nullptr ? static_cast<const char*>(newline) - source.data() : source.length();
+}
+
+// Up to the closing quote of a string literal. Lines are not counted while
+// scanning, so nothing but the quote needs finding.
+void Scanner::skipStringContents()
+{
+    const void* quote = std::memchr(source.data() + current, '"', source.length() - current);
+    current = quote != nullptr ? static_cast<const char*>(quote) - source.data() : source.length();
+}
+
+void Scanner::skipIdentifier()
+{
+#ifdef LOX_SCAN_SIMD
+    while(current + VECTOR_SIZE <= source.length())
+    {
+        __m128i chunk = load(source.data() + current);
+        __m128i letters = inRange(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 'z');
+        __m128i word = _mm_or_si128(_mm_or_si128(letters, inRange(chunk, '0', '9')), equals(chunk, '_'));
+        unsigned others = ~_mm_movemask_epi8(word) & 0xffff;
+        if(others != 0)
+        {
+            current += __builtin_ctz(others);
+            return;
+        }
+        current += VECTOR_SIZE;
+    }
+#endif
+
+    while(isAlphanumeric(peek()))
+    {
         advance();
     }
+}
+
+void Scanner::_string()
+{
+    skipStringContents();
 
     if(isAtEnd())
     {
-        error(line, "Unterminated string.");
+        lexicalError(LexicalError::UNTERMINATED_STRING);
         return;
     }
 
     advance();
 
-    std::string value = source.substr(start + 1, current - start - 2);
-    addToken(TokenType::STRING, value);
+    addSymbol(TokenType::STRING, source.substr(start + 1, current - start - 2));
 }
 
 bool Scanner::isDigit(char c)
@@ -201,7 +395,7 @@ void Scanner::number()
         }
     }
 
-    addToken(TokenType::NUMBER, std::stod(source.substr(start, current - start)));
+    addToken(TokenType::NUMBER);
 }
 
 char Scanner::peekNext()
@@ -216,16 +410,13 @@ char Scanner::peekNext()
 
 void Scanner::identifier()
 {
-    while(isAlphanumeric(peek())) 
-    {
-        advance();
-    }
+    skipIdentifier();
 
-    std::string text = source.substr(start, current - start);
-    TokenType type = keywords.count(text) ? keywords[text] : TokenType::IDENTIFIER;
+    std::string_view text = source.substr(start, current - start);
+    TokenType type = keywordType(text);
     if(type == TokenType::IDENTIFIER)
     {
-        addToken(TokenType::IDENTIFIER);
+        addSymbol(TokenType::IDENTIFIER, text);
     }
     else
     {
@@ -241,24 +432,4 @@ bool Scanner::isAlpha(char c)
 bool Scanner::isAlphanumeric(char c) 
 {
     return isAlpha(c) || isDigit(c);
-}
-
-void Scanner::initialiseKeywords()
-{
-    keywords["and"] = TokenType::AND;
-    keywords["class"] = TokenType::CLASS;
-    keywords["else"] = TokenType::ELSE;
-    keywords["false"] = TokenType::FALSE;
-    keywords["for"] = TokenType::FOR;
-    keywords["fun"] = TokenType::FUN;
-    keywords["if"] = TokenType::IF;
-    keywords["nil"] = TokenType::NIL;
-    keywords["or"] = TokenType::OR;
-    keywords["print"] = TokenType::PRINT;
-    keywords["return"] = TokenType::RETURN;
-    keywords["super"] = TokenType::SUPER;
-    keywords["this"] = TokenType::THIS;
-    keywords["true"] = TokenType::TRUE;
-    keywords["var"] = TokenType::VAR;
-    keywords["while"] = TokenType::WHILE;
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "./headers/ScannerThread.hpp"
+#include "./headers/Errors.hpp"
+#include "./headers/LoxString.hpp"
+
+ScannerThread::ScannerThread(const Source& source) : scanner{source, true}, thread{&ScannerThread::produce, this} {}
+
+ScannerThread::~ScannerThread()
+{
+    stopping.store(true, std::memory_order_relaxed);
+    thread.join();
+}
+
+void ScannerThread::produce()
+{
+    std::vector<Token> tokens;
+    bool done = false;
+    while(!done && !stopping.load(std::memory_order_relaxed))
+    {
+        while(tokens.size() < BATCH_SIZE && !done)
+        {
+            tokens.push_back(scanner.nextToken());
+            done = tokens.back().type == TokenType::EoF;
+        }
+
+        size_t slot = pushed.load(std::memory_order_relaxed);
+        while(slot - taken.load(std::memory_order_acquire) == RING_SIZE)
+        {
+            if(stopping.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        // The slot holds a batch the consumer has emptied; its capacity is
+        // reused for the next one.
+        tokens.swap(ring[slot % RING_SIZE]);
+        pushed.store(slot + 1, std::memory_order_release);
+    }
+}
+
+void ScannerThread::take()
+{
+    batch.clear();
+    next = 0;
+
+    size_t slot = taken.load(std::memory_order_relaxed);
+    while(pushed.load(std::memory_order_acquire) == slot)
+    {
+        std::this_thread::yield();
+    }
+
+    batch.swap(ring[slot % RING_SIZE]);
+    taken.store(slot + 1, std::memory_order_release);
+}
+
+Token ScannerThread::nextToken()
+{
+    for(;;)
+    {
+        if(next == batch.size())
+        {
+            take();
+        }
+
+        Token& token = batch[next];
+        switch(token.type)
+        {
+        case TokenType::EoF:
+            return token;
+        case TokenType::ERROR:
+            error(token.line(), Scanner::errorMessage(static_cast<Scanner::LexicalError>(token.literal)));
+            next++;
+            continue;
+        case TokenType::IDENTIFIER:
+            token.literal = TokenLiterals::add(LoxString::intern(token.lexeme()));
+            break;
+        case TokenType::STRING:
+            token.literal = TokenLiterals::add(LoxString::intern(token.lexeme().substr(1, token.length - 2)));
+            break;
+        default:
+            break;
+        }
+
+        next++;
+        return token;
+    }
+}
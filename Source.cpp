@@ -0,0 +1,143 @@
+#include "./headers/Source.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LOX_HAS_MMAP 1
+#endif
+
+// Live sources in order of their ranges.
+static std::vector<const Source*>& registry()
+{
+    static auto* sources = new std::vector<const Source*>();
+    return *sources;
+}
+
+static const Source* lastFound = nullptr;
+
+Source::Source(std::string text) : owned {std::move(text)}, contents {owned}
+{
+    registerRange();
+}
+
+// Takes the first gap between live ranges that is large enough, so the
+// ranges of destroyed Sources are reused. One offset past the end of the text
+// is the position of the EoF token.
+void Source::registerRange()
+{
+    std::vector<const Source*>& sources = registry();
+    uint64_t size = contents.size() + uint64_t {1};
+    uint64_t start = 0;
+    auto next = sources.begin();
+    for(; next != sources.end() && (*next)->base - start < size; ++next)
+    {
+        start = (*next)->base + ((*next)->contents.size() + uint64_t {1});
+    }
+
+    if(start + size > uint64_t {UINT32_MAX} + 1)
+    {
+        throw std::length_error("Source text exceeds the 4GB offset range.");
+    }
+    base = static_cast<uint32_t>(start);
+    sources.insert(next, this);
+}
+
+const Source& Source::at(uint32_t offset)
+{
+    if(lastFound != nullptr && offset - lastFound->base <= lastFound->contents.size())
+    {
+        return *lastFound;
+    }
+
+    std::vector<const Source*>& sources = registry();
+    auto next = std::upper_bound(sources.begin(), sources.end(), offset, [](uint32_t offset, const Source* source) { return offset < source->base; });
+    lastFound = *(next - 1);
+    return *lastFound;
+}
+
+int Source::line(uint32_t offset) const
+{
+    if(!linesFound)
+    {
+        const char* text = contents.data();
+        for(const char* newline = text; (newline = static_cast<const char*>(std::memchr(newline, '\n', text + contents.size() - newline))) != nullptr; newline++)
+        {
+            lineStarts.push_back(newline + 1 - text);
+        }
+        linesFound = true;
+    }
+
+    return std::upper_bound(lineStarts.begin(), lineStarts.end(), offset - base) - lineStarts.begin() + 1;
+}
+
+Source::~Source()
+{
+    if(lastFound == this)
+    {
+        lastFound = nullptr;
+    }
+    // A Source whose text did not fit was never registered.
+    std::vector<const Source*>& sources = registry();
+    auto registered = std::lower_bound(sources.begin(), sources.end(), base, [](const Source* source, uint32_t base) { return source->base < base; });
+    if(registered != sources.end() && *registered == this)
+    {
+        sources.erase(registered);
+    }
+
+#ifdef LOX_HAS_MMAP
+    if(mapping != nullptr)
+    {
+        munmap(mapping, mappingSize);
+    }
+#endif
+}
+
+std::unique_ptr<Source> Source::open(const std::string& path)
+{
+#ifdef LOX_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat status;
+    if(fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED)
+        {
+            close(fd);
+            // Scanning is one pass from start to end.
+            madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+            std::unique_ptr<Source> source {new Source()};
+            source->mapping = mapping;
+            source->mappingSize = status.st_size;
+            source->contents = std::string_view {static_cast<const char*>(mapping), source->mappingSize};
+            source->registerRange();
+            return source;
+        }
+    }
+    close(fd);
+#endif
+
+    // Empty files, files that cannot be mapped, and platforms without mmap.
+    std::ifstream file {path, std::ios::in | std::ios::binary | std::ios::ate};
+    if(!file)
+    {
+        return nullptr;
+    }
+
+    std::string text(file.tellg(), '\0');
+    file.seekg(0, std::ios::beg);
+    file.read(&text[0], text.size());
+    return std::make_unique<Source>(std::move(text));
+}
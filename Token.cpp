@@ -0,0 +1,47 @@
+#include "./headers/Token.hpp"
+
+std::deque<TokenLiterals::Entry>& TokenLiterals::entries()
+{
+    static auto* entries = new std::deque<Entry>(1);
+    return *entries;
+}
+
+std::vector<uint32_t>& TokenLiterals::freeIndices()
+{
+    static auto* indices = new std::vector<uint32_t>();
+    return *indices;
+}
+
+uint32_t TokenLiterals::add(const Ref<LoxString>& string)
+{
+    if(string->literal == 0)
+    {
+        std::vector<uint32_t>& free = freeIndices();
+        if(free.empty())
+        {
+            string->literal = entries().size();
+            entries().emplace_back();
+        }
+        else
+        {
+            string->literal = free.back();
+            free.pop_back();
+        }
+        entries()[string->literal].string = string;
+    }
+
+    entries()[string->literal].holds++;
+    return string->literal;
+}
+
+void TokenLiterals::release(uint32_t index)
+{
+    Entry& entry = entries()[index];
+    if(--entry.holds == 0)
+    {
+        entry.string->literal = 0;
+        entry.string = nullptr;
+        entry.keeper = 0;
+        freeIndices().push_back(index);
+    }
+}
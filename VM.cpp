@@ -0,0 +1,576 @@
+#include "./headers/VM.hpp"
+#include "./headers/Errors.hpp"
+
+#include <chrono>
+#include <iostream>
+
+static LoxValue clockNative(int argCount, LoxValue* args)
+{
+    auto ticks = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration<double>{ticks}.count();
+}
+
+VM::VM() : stack {new LoxValue[STACK_MAX]}, stackTop {stack.get()}, frames(FRAMES_MAX)
+{
+    defineNative("clock", 0, clockNative);
+}
+
+void VM::interpret(Ref<VMFunction> script)
+{
+    Ref<VMClosure> closure = makeObject<VMClosure>(std::move(script));
+    push(closure);
+    if(call(closure.get(), 0))
+    {
+        run();
+    }
+}
+
+int VM::globalSlot(const std::string& name)
+{
+    auto elem = globalSlots.find(name);
+    if(elem != globalSlots.end())
+    {
+        return elem->second;
+    }
+
+    if(globals.size() > UINT16_MAX)
+    {
+        return -1;
+    }
+
+    globals.push_back(Global {name});
+    globalSlots.emplace(name, globals.size() - 1);
+    return globals.size() - 1;
+}
+
+void VM::resetStack()
+{
+    closeUpvalues(stack.get());
+    while(stackTop > stack.get())
+    {
+        pop();
+    }
+    frameCount = 0;
+}
+
+void VM::runtimeError(const std::string& message)
+{
+    CallFrame& frame = frames[frameCount - 1];
+    Chunk& chunk = frame.closure->function->chunk;
+    size_t instruction = frame.ip - chunk.code.data() - 1;
+    ::runtimeError(chunk.lines[instruction], message);
+    resetStack();
+}
+
+void VM::defineNative(const std::string& name, int arity, VMNative::NativeFn function)
+{
+    Global& global = globals[globalSlot(name)];
+    global.value = makeObject<VMNative>(arity, function);
+    global.defined = true;
+}
+
+bool VM::call(VMClosure* closure, int argCount)
+{
+    if(argCount != closure->function->arity)
+    {
+        runtimeError("Expected " + std::to_string(closure->function->arity) +
+            " arguments but got " + std::to_string(argCount) + ".");
+        return false;
+    }
+
+    if(frameCount == FRAMES_MAX || stackTop + UINT8_MAX + 1 > stack.get() + STACK_MAX)
+    {
+        runtimeError("Stack overflow.");
+        return false;
+    }
+
+    CallFrame& frame = frames[frameCount++];
+    frame.closure = closure;
+    frame.ip = closure->function->chunk.code.data();
+    frame.slots = stackTop - argCount - 1;
+    return true;
+}
+
+bool VM::callValue(const LoxValue& callee, int argCount)
+{
+    if(callee.isObject())
+    {
+        switch(callee.asObject()->objectType)
+        {
+        case ObjectType::VM_BOUND_METHOD:
+        {
+            VMBoundMethod* bound = callee.asObject<VMBoundMethod>();
+            Ref<VMClosure> method = bound->method;
+            stackTop[-argCount - 1] = bound->receiver;
+            return call(method.get(), argCount);
+        }
+        case ObjectType::VM_CLASS:
+        {
+            VMClass* klass = callee.asObject<VMClass>();
+            stackTop[-argCount - 1] = makeObject<VMInstance>(Ref<VMClass>(klass));
+            if(klass->initializer != nullptr)
+            {
+                return call(klass->initializer.get(), argCount);
+            }
+            if(argCount != 0)
+            {
+                runtimeError("Expected 0 arguments but got " + std::to_string(argCount) + ".");
+                return false;
+            }
+            return true;
+        }
+        case ObjectType::VM_CLOSURE:
+            return call(callee.asObject<VMClosure>(), argCount);
+        case ObjectType::VM_NATIVE:
+        {
+            VMNative* native = callee.asObject<VMNative>();
+            if(argCount != native->arity)
+            {
+                runtimeError("Expected " + std::to_string(native->arity) +
+                    " arguments but got " + std::to_string(argCount) + ".");
+                return false;
+            }
+            LoxValue result = native->function(argCount, stackTop - argCount);
+            for(int i = 0; i <= argCount; i++)
+            {
+                pop();
+            }
+            push(std::move(result));
+            return true;
+        }
+        default:
+            break;
+        }
+    }
+
+    runtimeError("Can only call functions and classes.");
+    return false;
+}
+
+bool VM::invoke(LoxString* name, int argCount)
+{
+    LoxValue& receiver = peek(argCount);
+    if(!receiver.isObject(ObjectType::VM_INSTANCE))
+    {
+        runtimeError("Only instances have properties.");
+        return false;
+    }
+
+    VMInstance* instance = receiver.asObject<VMInstance>();
+    auto field = instance->fields.find(Ref<LoxString>(name));
+    if(field != instance->fields.end())
+    {
+        receiver = field->second;
+        return callValue(receiver, argCount);
+    }
+
+    return invokeFromClass(instance->klass.get(), name, argCount);
+}
+
+bool VM::invokeFromClass(VMClass* klass, LoxString* name, int argCount)
+{
+    auto method = klass->methods.find(Ref<LoxString>(name));
+    if(method == klass->methods.end())
+    {
+        runtimeError("Undefined property '" + name->toString() + "'.");
+        return false;
+    }
+    return call(method->second.get(), argCount);
+}
+
+bool VM::bindMethod(VMClass* klass, LoxString* name)
+{
+    auto method = klass->methods.find(Ref<LoxString>(name));
+    if(method == klass->methods.end())
+    {
+        runtimeError("Undefined property '" + name->toString() + "'.");
+        return false;
+    }
+
+    peek(0) = makeObject<VMBoundMethod>(peek(0), method->second);
+    return true;
+}
+
+Ref<VMUpvalue> VM::captureUpvalue(LoxValue* local)
+{
+    VMUpvalue* previous = nullptr;
+    VMUpvalue* upvalue = openUpvalues.get();
+    while(upvalue != nullptr && upvalue->location > local)
+    {
+        previous = upvalue;
+        upvalue = upvalue->next.get();
+    }
+
+    if(upvalue != nullptr && upvalue->location == local)
+    {
+        return Ref<VMUpvalue>(upvalue);
+    }
+
+    Ref<VMUpvalue> created = makeObject<VMUpvalue>(local);
+    created->next = Ref<VMUpvalue>(upvalue);
+    if(previous == nullptr)
+    {
+        openUpvalues = created;
+    }
+    else
+    {
+        previous->next = created;
+    }
+    return created;
+}
+
+void VM::closeUpvalues(LoxValue* last)
+{
+    while(openUpvalues != nullptr && openUpvalues->location >= last)
+    {
+        Ref<VMUpvalue> upvalue = openUpvalues;
+        upvalue->closed = *upvalue->location;
+        upvalue->location = &upvalue->closed;
+        openUpvalues = upvalue->next;
+        upvalue->next = nullptr;
+    }
+}
+
+bool VM::run()
+{
+    CallFrame* frame = &frames[frameCount - 1];
+    uint8_t* ip = frame->ip;
+    LoxValue* constants = frame->closure->function->chunk.constants.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define READ_CONSTANT() (constants[READ_SHORT()])
+#define READ_STRING() (READ_CONSTANT().asObject<LoxString>())
+#define SAVE_FRAME() (frame->ip = ip)
+#define LOAD_FRAME() \
+    (frame = &frames[frameCount - 1], ip = frame->ip, \
+     constants = frame->closure->function->chunk.constants.data())
+#define RUNTIME_ERROR(message) \
+    do { SAVE_FRAME(); runtimeError(message); return false; } while(false)
+#define NUMBER_OPERATION(op) \
+    do { \
+        if(!peek(0).isNumber() || !peek(1).isNumber()) \
+        { \
+            RUNTIME_ERROR("Operands must be numbers."); \
+        } \
+        stackTop[-2] = stackTop[-2].asNumber() op stackTop[-1].asNumber(); \
+        stackTop--; \
+    } while(false)
+
+    for(;;)
+    {
+        switch(static_cast<OpCode>(READ_BYTE()))
+        {
+        case OpCode::CONSTANT:
+            push(READ_CONSTANT());
+            break;
+        case OpCode::NIL:
+            push(nullptr);
+            break;
+        case OpCode::TRUE:
+            push(true);
+            break;
+        case OpCode::FALSE:
+            push(false);
+            break;
+        case OpCode::POP:
+            pop();
+            break;
+        case OpCode::GET_LOCAL:
+            push(frame->slots[READ_BYTE()]);
+            break;
+        case OpCode::SET_LOCAL:
+            frame->slots[READ_BYTE()] = peek(0);
+            break;
+        case OpCode::GET_GLOBAL:
+        {
+            Global& global = globals[READ_SHORT()];
+            if(!global.defined)
+            {
+                RUNTIME_ERROR("Undefined variable '" + global.name + "'.");
+            }
+            if(global.value.isNil())
+            {
+                RUNTIME_ERROR("Unassigned variable '" + global.name + "'.");
+            }
+            push(global.value);
+            break;
+        }
+        case OpCode::DEFINE_GLOBAL:
+        {
+            Global& global = globals[READ_SHORT()];
+            global.value = pop();
+            global.defined = true;
+            break;
+        }
+        case OpCode::SET_GLOBAL:
+        {
+            Global& global = globals[READ_SHORT()];
+            if(!global.defined)
+            {
+                RUNTIME_ERROR("Undefined variable '" + global.name + "'.");
+            }
+            global.value = peek(0);
+            break;
+        }
+        case OpCode::GET_UPVALUE:
+            push(*frame->closure->upvalues[READ_BYTE()]->location);
+            break;
+        case OpCode::SET_UPVALUE:
+            *frame->closure->upvalues[READ_BYTE()]->location = peek(0);
+            break;
+        case OpCode::GET_PROPERTY:
+        {
+            LoxString* name = READ_STRING();
+            if(!peek(0).isObject(ObjectType::VM_INSTANCE))
+            {
+                RUNTIME_ERROR("Only instances have properties.");
+            }
+
+            VMInstance* instance = peek(0).asObject<VMInstance>();
+            auto field = instance->fields.find(Ref<LoxString>(name));
+            if(field != instance->fields.end())
+            {
+                peek(0) = field->second;
+                break;
+            }
+
+            SAVE_FRAME();
+            if(!bindMethod(instance->klass.get(), name))
+            {
+                return false;
+            }
+            break;
+        }
+        case OpCode::SET_PROPERTY:
+        {
+            LoxString* name = READ_STRING();
+            if(!peek(1).isObject(ObjectType::VM_INSTANCE))
+            {
+                RUNTIME_ERROR("Only instances have fields.");
+            }
+
+            peek(1).asObject<VMInstance>()->fields[Ref<LoxString>(name)] = peek(0);
+            LoxValue value = pop();
+            peek(0) = std::move(value);
+            break;
+        }
+        case OpCode::GET_SUPER:
+        {
+            LoxString* name = READ_STRING();
+            LoxValue superclass = pop();
+            SAVE_FRAME();
+            if(!bindMethod(superclass.asObject<VMClass>(), name))
+            {
+                return false;
+            }
+            break;
+        }
+        case OpCode::EQUAL:
+        {
+            bool equal = peek(1).equals(peek(0));
+            pop();
+            peek(0) = equal;
+            break;
+        }
+        case OpCode::NOT_EQUAL:
+        {
+            bool equal = peek(1).equals(peek(0));
+            pop();
+            peek(0) = !equal;
+            break;
+        }
+        case OpCode::GREATER:
+            NUMBER_OPERATION(>);
+            break;
+        case OpCode::GREATER_EQUAL:
+            NUMBER_OPERATION(>=);
+            break;
+        case OpCode::LESS:
+            NUMBER_OPERATION(<);
+            break;
+        case OpCode::LESS_EQUAL:
+            NUMBER_OPERATION(<=);
+            break;
+        case OpCode::ADD:
+        {
+            if(peek(0).isNumber() && peek(1).isNumber())
+            {
+                stackTop[-2] = stackTop[-2].asNumber() + stackTop[-1].asNumber();
+                stackTop--;
+            }
+            else if(peek(0).isString() && peek(1).isString())
+            {
+                LoxValue result = LoxString::concat(peek(1).asObject<LoxString>(), peek(0).asObject<LoxString>());
+                pop();
+                peek(0) = std::move(result);
+            }
+            else
+            {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
+            }
+            break;
+        }
+        case OpCode::SUBTRACT:
+            NUMBER_OPERATION(-);
+            break;
+        case OpCode::MULTIPLY:
+            NUMBER_OPERATION(*);
+            break;
+        case OpCode::DIVIDE:
+            NUMBER_OPERATION(/);
+            break;
+        case OpCode::NOT:
+            peek(0) = !peek(0).isTruthy();
+            break;
+        case OpCode::NEGATE:
+            if(!peek(0).isNumber())
+            {
+                RUNTIME_ERROR("Operand must be a number.");
+            }
+            peek(0) = -peek(0).asNumber();
+            break;
+        case OpCode::PRINT:
+            std::cout << pop().toString() << "\n";
+            break;
+        case OpCode::JUMP:
+        {
+            uint16_t offset = READ_SHORT();
+            ip += offset;
+            break;
+        }
+        case OpCode::JUMP_IF_FALSE:
+        {
+            uint16_t offset = READ_SHORT();
+            if(!peek(0).isTruthy())
+            {
+                ip += offset;
+            }
+            break;
+        }
+        case OpCode::LOOP:
+        {
+            uint16_t offset = READ_SHORT();
+            ip -= offset;
+            break;
+        }
+        case OpCode::CALL:
+        {
+            int argCount = READ_BYTE();
+            SAVE_FRAME();
+            if(!callValue(peek(argCount), argCount))
+            {
+                return false;
+            }
+            LOAD_FRAME();
+            break;
+        }
+        case OpCode::INVOKE:
+        {
+            LoxString* method = READ_STRING();
+            int argCount = READ_BYTE();
+            SAVE_FRAME();
+            if(!invoke(method, argCount))
+            {
+                return false;
+            }
+            LOAD_FRAME();
+            break;
+        }
+        case OpCode::SUPER_INVOKE:
+        {
+            LoxString* method = READ_STRING();
+            int argCount = READ_BYTE();
+            LoxValue superclass = pop();
+            SAVE_FRAME();
+            if(!invokeFromClass(superclass.asObject<VMClass>(), method, argCount))
+            {
+                return false;
+            }
+            LOAD_FRAME();
+            break;
+        }
+        case OpCode::CLOSURE:
+        {
+            VMFunction* function = READ_CONSTANT().asObject<VMFunction>();
+            Ref<VMClosure> closure = makeObject<VMClosure>(Ref<VMFunction>(function));
+            for(int i = 0; i < function->upvalueCount; i++)
+            {
+                uint8_t isLocal = READ_BYTE();
+                uint8_t index = READ_BYTE();
+                if(isLocal)
+                {
+                    closure->upvalues[i] = captureUpvalue(frame->slots + index);
+                }
+                else
+                {
+                    closure->upvalues[i] = frame->closure->upvalues[index];
+                }
+            }
+            push(std::move(closure));
+            break;
+        }
+        case OpCode::CLOSE_UPVALUE:
+            closeUpvalues(stackTop - 1);
+            pop();
+            break;
+        case OpCode::RETURN:
+        {
+            LoxValue result = pop();
+            closeUpvalues(frame->slots);
+            frameCount--;
+            while(stackTop > frame->slots)
+            {
+                pop();
+            }
+            if(frameCount == 0)
+            {
+                return true;
+            }
+
+            push(std::move(result));
+            LOAD_FRAME();
+            break;
+        }
+        case OpCode::CLASS:
+            push(makeObject<VMClass>(READ_STRING()->toString()));
+            break;
+        case OpCode::INHERIT:
+        {
+            if(!peek(1).isObject(ObjectType::VM_CLASS))
+            {
+                RUNTIME_ERROR("Superclass must be a class.");
+            }
+
+            VMClass* superclass = peek(1).asObject<VMClass>();
+            VMClass* subclass = peek(0).asObject<VMClass>();
+            subclass->methods = superclass->methods;
+            subclass->initializer = superclass->initializer;
+            pop();
+            break;
+        }
+        case OpCode::METHOD:
+        {
+            LoxString* name = READ_STRING();
+            VMClass* klass = peek(1).asObject<VMClass>();
+            Ref<VMClosure> method(peek(0).asObject<VMClosure>());
+            if(name->chars() == "init")
+            {
+                klass->initializer = method;
+            }
+            klass->methods[Ref<LoxString>(name)] = std::move(method);
+            pop();
+            break;
+        }
+        }
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef READ_CONSTANT
+#undef READ_STRING
+#undef SAVE_FRAME
+#undef LOAD_FRAME
+#undef RUNTIME_ERROR
+#undef NUMBER_OPERATION
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../headers/AstArena.hpp"
+#include "../headers/Lox.hpp"
+#include "../headers/Parser.hpp"
+#include "../headers/Resolver.hpp"
+#include "../headers/Scanner.hpp"
+#include "../headers/ScannerThread.hpp"
+#include "../headers/Source.hpp"
+
+#ifndef BENCHMARK_SCRIPTS_PATH
+#define BENCHMARK_SCRIPTS_PATH "benchmark/scripts"
+#endif
+
+const int RUNS = 5;
+// Bytes to put through the scanner per timed run; small scripts are scanned
+// repeatedly to reach it.
+const size_t SCAN_BYTES = 32 * 1024 * 1024;
+// Size of the generated program the front end is timed on.
+const size_t SYNTHETIC_BYTES = 16 * 1024 * 1024;
+
+const std::vector<std::string> DEFAULT_SCRIPTS = {
+    "fib.lox",
+    "properties.lox",
+};
+
+// Runs one script end to end (scan, parse, resolve, execute) and returns the
+// wall time in milliseconds. Program output is discarded.
+double timeRun(const std::string& path, TWI::Backend backend)
+{
+    std::ostringstream sink;
+    std::streambuf* previous = std::cout.rdbuf(sink.rdbuf());
+
+    auto start = std::chrono::steady_clock::now();
+    TWI::Lox lox{backend};
+    lox.runFile(path);
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout.rdbuf(previous);
+    return std::chrono::duration<double, std::milli>{end - start}.count();
+}
+
+// Scans one script without parsing or running it and returns the best
+// throughput over several runs in MB/s.
+double scanThroughput(const std::string& path)
+{
+    std::unique_ptr<Source> source = Source::open(path);
+    if(source == nullptr || source->text().empty())
+    {
+        return 0;
+    }
+
+    std::string_view text = source->text();
+    size_t repeats = std::max<size_t>(1, SCAN_BYTES / text.size());
+    double best = 0;
+    for(int i = 0; i < RUNS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t j = 0; j < repeats; j++)
+        {
+            Scanner scanner{*source};
+            for(const Token& token : scanner.scanTokens())
+            {
+                if(token.literal != 0)
+                {
+                    TokenLiterals::release(token.literal);
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>{end - start}.count();
+        best = std::max(best, text.size() * repeats / seconds / 1e6);
+    }
+    return best;
+}
+
+// A large program of classes, functions, variables, strings and comments, the
+// kind of input the scanner thread is meant for.
+std::string syntheticProgram(size_t bytes)
+{
+    std::string program;
+    for(int i = 0; program.size() < bytes; i++)
+    {
+        std::string n = std::to_string(i);
+        program += "// Generated declarations, group " + n + ".\n";
+        program += "class Point" + n + " {\n    init(x, y) { this.x = x; this.y = y; }\n    sum() { return this.x + this.y; }\n}\n";
+        program += "fun scale" + n + "(p, k) {\n    var s = p.sum() * k;\n    if (s > 100 and k != 0) { return s - 1.5; }\n    return s + 2.25;\n}\n";
+        program += "var label" + n + " = \"label number " + n + "\";\n";
+        program += "var value" + n + " = scale" + n + "(Point" + n + "(" + n + ", " + n + " + 1), 3) + 0.5;\n";
+    }
+    return program;
+}
+
+// Scans, parses and resolves a program one top-level declaration at a time,
+// as a streaming run does, and returns the best wall time in milliseconds.
+double frontEndTime(const Source& source, bool scanThread)
+{
+    double best = 0;
+    for(int i = 0; i < RUNS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<TokenSource> tokens;
+        if(scanThread)
+        {
+            tokens = std::make_unique<ScannerThread>(source);
+        }
+        else
+        {
+            tokens = std::make_unique<Scanner>(source);
+        }
+
+        AstArena arena;
+        Parser parser{*tokens, arena};
+        Resolver resolver;
+        while(!parser.isAtEnd())
+        {
+            std::vector<Stmt*> statements {parser.parseDeclaration(arena)};
+            resolver.resolve(statements);
+            arena.clear();
+        }
+        tokens.reset();
+        auto end = std::chrono::steady_clock::now();
+
+        double milliseconds = std::chrono::duration<double, std::milli>{end - start}.count();
+        best = i == 0 ? milliseconds : std::min(best, milliseconds);
+    }
+    return best;
+}
+
+void benchmarkFrontEnd()
+{
+    Source program {syntheticProgram(SYNTHETIC_BYTES)};
+    double serial = frontEndTime(program, false);
+    double threaded = frontEndTime(program, true);
+
+    std::printf("%-24s %-12s best %9.2f ms\n", "synthetic.lox", "front end", serial);
+    std::printf("%-24s %-12s best %9.2f ms   speedup %.2fx\n", "synthetic.lox", "scan thread", threaded, serial / threaded);
+}
+
+void benchmark(const std::string& path, TWI::Backend backend)
+{
+    std::vector<double> times;
+    for(int i = 0; i < RUNS; i++)
+    {
+        times.push_back(timeRun(path, backend));
+    }
+    std::sort(times.begin(), times.end());
+
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    const char* backendName = backend == TWI::Backend::BYTECODE_VM ? "vm" : "tree-walker";
+    std::printf("%-24s %-12s best %9.2f ms   median %9.2f ms\n", name.c_str(), backendName, times.front(), times[RUNS / 2]);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> scripts;
+    for(int i = 1; i < argc; i++)
+    {
+        scripts.push_back(argv[i]);
+    }
+    if(scripts.empty())
+    {
+        for(const std::string& script : DEFAULT_SCRIPTS)
+        {
+            scripts.push_back(std::string(BENCHMARK_SCRIPTS_PATH) + "/" + script);
+        }
+    }
+
+    for(const std::string& script : scripts)
+    {
+        std::string name = script.substr(script.find_last_of('/') + 1);
+        std::printf("%-24s %-12s %9.1f MB/s\n", name.c_str(), "scanner", scanThroughput(script));
+        benchmark(script, TWI::Backend::TREE_WALKER);
+        benchmark(script, TWI::Backend::BYTECODE_VM);
+    }
+    benchmarkFrontEnd();
+    return 0;
+}
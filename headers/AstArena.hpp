@@ -0,0 +1,142 @@
+#ifndef AST_ARENA_HPP
+#define AST_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Token.hpp"
+
+// Owns every Expr and Stmt node of one parsed program. Nodes are bump
+// allocated out of blocks and refer to each other with plain pointers; they
+// are all destroyed together when the arena goes away or is cleared. Blocks
+// start small and double up to BLOCK_SIZE, so an arena holding a single
+// top-level declaration stays small.
+//
+// The arena also holds the TokenLiterals entries of the tokens parsed into it,
+// one hold per entry, and releases them with the nodes.
+class AstArena
+{
+private:
+    static constexpr size_t MIN_BLOCK_SIZE = 1024;
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Finalizer
+    {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* next = nullptr;
+    std::byte* end = nullptr;
+    std::vector<Finalizer> finalizers;
+    std::vector<uint32_t> literals;
+    // Tells the literals this arena holds apart from those kept by an arena
+    // before it was last cleared, or by another arena.
+    uint64_t generation = ++generations;
+
+    static inline uint64_t generations = 0;
+
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    ~AstArena()
+    {
+        destroyNodes();
+    }
+
+    // Destroys every node, keeping the last and largest block to allocate
+    // the next ones from.
+    void clear()
+    {
+        destroyNodes();
+        finalizers.clear();
+        generation = ++generations;
+        if(blocks.empty())
+        {
+            return;
+        }
+
+        size_t blockSize = end - blocks.back().get();
+        blocks.erase(blocks.begin(), blocks.end() - 1);
+        next = blocks.back().get();
+        end = next + blockSize;
+    }
+
+    // Takes over a token's hold on its literal.
+    void keepLiteral(uint32_t literal)
+    {
+        if(literal == 0)
+        {
+            return;
+        }
+
+        TokenLiterals::Entry& entry = TokenLiterals::entries()[literal];
+        if(entry.keeper == generation)
+        {
+            TokenLiterals::release(literal);
+            return;
+        }
+        entry.keeper = generation;
+        literals.push_back(literal);
+    }
+
+    template <class T, class... Args>
+    T* make(Args&&... args)
+    {
+        T* node = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr(!std::is_trivially_destructible_v<T>)
+        {
+            finalizers.push_back(Finalizer {node, [](void* object) { static_cast<T*>(object)->~T(); }});
+        }
+        return node;
+    }
+
+private:
+    void* allocate(size_t size, size_t align)
+    {
+        std::byte* start = next == nullptr ? nullptr : alignUp(next, align);
+        if(start == nullptr || start + size > end)
+        {
+            size_t blockSize = blocks.empty() ? MIN_BLOCK_SIZE : std::min<size_t>(2 * (end - blocks.back().get()), BLOCK_SIZE);
+            if(size + align > blockSize)
+            {
+                blockSize = size + align;
+            }
+            blocks.emplace_back(new std::byte[blockSize]);
+            next = blocks.back().get();
+            end = next + blockSize;
+            start = alignUp(next, align);
+        }
+        next = start + size;
+        return start;
+    }
+
+    void destroyNodes()
+    {
+        for(auto finalizer = finalizers.rbegin(); finalizer != finalizers.rend(); ++finalizer)
+        {
+            finalizer->destroy(finalizer->object);
+        }
+        for(uint32_t literal : literals)
+        {
+            TokenLiterals::release(literal);
+        }
+        literals.clear();
+    }
+
+    static std::byte* alignUp(std::byte* pointer, size_t align)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        return pointer + ((align - address % align) % align);
+    }
+};
+
+#endif // AST_ARENA_HPP
@@ -3,66 +3,71 @@
 #ifndef AST_PRINTER_HPP
 #define AST_PRINTER_HPP
 
-#include <any>
 #include <cassert>
 #include <memory>
 #include <string>
 #include <sstream>
 #include <type_traits>
 #include "Expr.hpp"
+#include "LoxString.hpp"
 
 class AstPrinter : public ExprVisitor
 {
 public:
-    std::string print(std::shared_ptr<Expr> expr)
+    std::string print(Expr* expr)
     {
-        return std::any_cast<std::string>(expr->accept(*this));
+        return expr->accept(*this).asObject<LoxString>()->toString();
     }
 
-    std::any visitBinaryExpr(std::shared_ptr<Binary> expr) override
+    LoxValue visitBinaryExpr(Binary& expr) override
     {
-        return parenthesize(expr->op.lexeme, expr->left, expr->right);
+        return text(parenthesize(expr.op.lexeme(), expr.left, expr.right));
     }
 
-    std::any visitGroupingExpr(std::shared_ptr<Grouping> expr) override
+    LoxValue visitGroupingExpr(Grouping& expr) override
     {
-        return parenthesize("group", expr->expression);
+        return text(parenthesize("group", expr.expression));
     }
 
-    std::any visitLiteralExpr(std::shared_ptr<Literal> expr) override
+    LoxValue visitLiteralExpr(Literal& expr) override
     {
-        auto &value_type = expr->value.type();
+        const LoxValue& value = expr.value;
 
-        if (value_type == typeid(nullptr))
+        if (value.isNil())
         {
-            return "nil";
+            return text("nil");
         }
-        else if (value_type == typeid(std::string))
+        else if (value.isString())
         {
-            return std::any_cast<std::string>(expr->value);
+            return value;
         }
-        else if (value_type == typeid(double))
+        else if (value.isNumber())
         {
-            return std::to_string(std::any_cast<double>(expr->value));
+            return text(std::to_string(value.asNumber()));
         }
-        else if (value_type == typeid(bool))
+        else if (value.isBool())
         {
-            return std::any_cast<bool>(expr->value) ? "true" : "false";
+            return text(value.asBool() ? "true" : "false");
         }
 
-        return "Error in visitLiteralExpr: literal type not recognized.";
+        return text("Error in visitLiteralExpr: literal type not recognized.");
     }
 
-    std::any visitUnaryExpr(std::shared_ptr<Unary> expr) override 
+    LoxValue visitUnaryExpr(Unary& expr) override 
     {
-        return parenthesize(expr->op.lexeme, expr->right);
+        return text(parenthesize(expr.op.lexeme(), expr.right));
     }
 
 private:
+    LoxValue text(std::string chars)
+    {
+        return LoxString::intern(std::move(chars));
+    }
+
     template <class... E>
     std::string parenthesize(std::string_view name, E... expr)
     {
-        assert((... && std::is_same_v<E, std::shared_ptr<Expr>>));
+        assert((... && std::is_same_v<E, Expr*>));
 
         std::ostringstream builder;
 
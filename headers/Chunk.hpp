@@ -0,0 +1,81 @@
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+
+#include <cstdint>
+#include <vector>
+#include "LoxValue.hpp"
+
+// Instruction set of the bytecode VM. Operands follow the opcode inline;
+// constant, global and jump operands are 16-bit big-endian, local slot,
+// upvalue and argument-count operands are a single byte.
+enum class OpCode : uint8_t
+{
+    CONSTANT,
+    NIL,
+    TRUE,
+    FALSE,
+    POP,
+    GET_LOCAL,
+    SET_LOCAL,
+    GET_GLOBAL,
+    DEFINE_GLOBAL,
+    SET_GLOBAL,
+    GET_UPVALUE,
+    SET_UPVALUE,
+    GET_PROPERTY,
+    SET_PROPERTY,
+    GET_SUPER,
+    EQUAL,
+    NOT_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    NOT,
+    NEGATE,
+    PRINT,
+    JUMP,
+    JUMP_IF_FALSE,
+    LOOP,
+    CALL,
+    INVOKE,
+    SUPER_INVOKE,
+    CLOSURE,
+    CLOSE_UPVALUE,
+    RETURN,
+    CLASS,
+    INHERIT,
+    METHOD
+};
+
+class Chunk
+{
+public:
+    std::vector<uint8_t> code;
+    std::vector<int> lines;
+    std::vector<LoxValue> constants;
+
+public:
+    void write(uint8_t byte, int line)
+    {
+        code.push_back(byte);
+        lines.push_back(line);
+    }
+
+    void write(OpCode op, int line)
+    {
+        write(static_cast<uint8_t>(op), line);
+    }
+
+    int addConstant(LoxValue value)
+    {
+        constants.push_back(std::move(value));
+        return constants.size() - 1;
+    }
+};
+
+#endif // CHUNK_HPP
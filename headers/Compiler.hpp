@@ -0,0 +1,128 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Expr.hpp"
+#include "Stmt.hpp"
+#include "Token.hpp"
+#include "Chunk.hpp"
+#include "VM.hpp"
+#include "VMObjects.hpp"
+
+// Lowers a parsed and resolved program to bytecode for the VM. Locals live in
+// stack slots of their function's call frame; variables of enclosing functions
+// are reached through upvalues, everything else is a global.
+class Compiler : public ExprVisitor, public StmtVisitor
+{
+private:
+    enum class FunctionType
+    {
+        SCRIPT,
+        FUNCTION,
+        INITIALIZER,
+        METHOD
+    };
+
+    struct Local
+    {
+        std::string_view name;
+        int depth;
+        bool isCaptured;
+    };
+
+    struct Upvalue
+    {
+        uint8_t index;
+        bool isLocal;
+    };
+
+    struct FunctionState
+    {
+        FunctionState* enclosing;
+        Ref<VMFunction> function;
+        FunctionType type;
+        std::vector<Local> locals;
+        std::vector<Upvalue> upvalues;
+        int scopeDepth = 0;
+        std::unordered_map<std::string_view, uint16_t> stringConstants;
+        std::unordered_map<uint64_t, uint16_t> numberConstants;
+    };
+
+    struct ClassState
+    {
+        ClassState* enclosing;
+        bool hasSuperclass;
+    };
+
+    VM& vm;
+    FunctionState* current = nullptr;
+    ClassState* currentClass = nullptr;
+    int line = 0;
+
+public:
+    Compiler(VM& vm) : vm {vm} {}
+    Ref<VMFunction> compile(const std::vector<Stmt*>& statements);
+
+    LoxValue visitAssignExpr(Assign& expr) override;
+    LoxValue visitBinaryExpr(Binary& expr) override;
+    LoxValue visitGroupingExpr(Grouping& expr) override;
+    LoxValue visitLiteralExpr(Literal& expr) override;
+    LoxValue visitUnaryExpr(Unary& expr) override;
+    LoxValue visitVariableExpr(Variable& expr) override;
+    LoxValue visitLogicalExpr(Logical& expr) override;
+    LoxValue visitCallExpr(Call& expr) override;
+    LoxValue visitGetExpr(Get& expr) override;
+    LoxValue visitSetExpr(Set& expr) override;
+    LoxValue visitThisExpr(This& expr) override;
+    LoxValue visitSuperExpr(Super& expr) override;
+
+    void visitBlockStmt(Block& stmt) override;
+    void visitExpressionStmt(Expression& stmt) override;
+    void visitPrintStmt(Print& stmt) override;
+    void visitVarStmt(Var& stmt) override;
+    void visitIfStmt(If& stmt) override;
+    void visitWhileStmt(While& stmt) override;
+    void visitFunctionStmt(Function& stmt) override;
+    void visitReturnStmt(Return& stmt) override;
+    void visitClassStmt(Class& stmt) override;
+
+private:
+    void compile(Stmt* stmt);
+    void compile(Expr* expr);
+    void function(Function* stmt, FunctionType type);
+
+    Chunk& chunk();
+    void emit(uint8_t byte);
+    void emit(OpCode op);
+    void emit(OpCode op, uint8_t operand);
+    void emitShort(OpCode op, uint16_t operand);
+    int emitJump(OpCode op);
+    void patchJump(int offset);
+    void emitLoop(int loopStart);
+    void emitReturn();
+
+    uint16_t makeConstant(LoxValue value);
+    uint16_t stringConstant(std::string_view chars);
+    uint16_t numberConstant(double number);
+    uint16_t globalSlot(std::string_view name);
+
+    void beginScope();
+    void endScope();
+    void addLocal(std::string_view name);
+    void markInitialized();
+    void declareVariable(const Token& name);
+    void defineVariable(const Token& name);
+    void getVariable(std::string_view name);
+    void setVariable(std::string_view name);
+    int resolveLocal(FunctionState* state, std::string_view name);
+    int resolveUpvalue(FunctionState* state, std::string_view name);
+    int addUpvalue(FunctionState* state, uint8_t index, bool isLocal);
+};
+
+#endif // COMPILER_HPP
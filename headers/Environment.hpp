@@ -1,31 +1,23 @@
 #ifndef ENVIRONMENT_HPP
 #define ENVIRONMENT_HPP
 
-#include <any>
-#include <memory>
 #include <unordered_map>
-#include <functional>
-#include <string>
 #include "Token.hpp"
+#include "LoxString.hpp"
+#include "LoxValue.hpp"
 #include "RuntimeError.hpp"
 
-class Environment : public std::enable_shared_from_this<Environment>
+// The global scope. Globals are late bound, so they live in a name-keyed map;
+// every local is resolved ahead of time to a frame slot or an upvalue.
+class Environment
 {
 private:
-    std::unordered_map<std::string, std::any> values;
+    std::unordered_map<Ref<LoxString>, LoxValue> values;
 
 public:
-    std::shared_ptr<Environment> enclosing;
-
-public:
-    Environment() : enclosing(nullptr) {}
-    Environment(std::shared_ptr<Environment> enclosing) : enclosing(enclosing) {}
-    std::any get(Token name);
-    void define(std::string name, std::any value);
-    void assign(Token name, std::any value);
-    std::any getAt(int distance, std::string name);
-    std::shared_ptr<Environment> ancestor(int distance);
-    void assignAt(int distance, Token& name, std::any value);
+    LoxValue get(const Token& name);
+    void define(Ref<LoxString> name, LoxValue value);
+    void assign(const Token& name, LoxValue value);
 };
 
-#endif // ENVIRONMENT_HPP
\ No newline at end of file
+#endif // ENVIRONMENT_HPP
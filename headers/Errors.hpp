@@ -4,21 +4,42 @@
 #include "RuntimeError.hpp"
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 inline bool hadError = false;
 inline bool hadRuntimeError = false;
 
+// While set, errors are collected here instead of being reported, for a
+// caller that only knows later whether, and in what order, to report them.
+inline std::vector<std::string>* heldErrors = nullptr;
+
 inline static void report(int line, std::string where, std::string message)
 {
-    std::cerr << "[line " << line << "] Error" << where << ": " << message << "\n";
+    std::string text = "[line " + std::to_string(line) + "] Error" + where + ": " + message + "\n";
+    if(heldErrors != nullptr)
+    {
+        heldErrors->push_back(std::move(text));
+        return;
+    }
+    std::cerr << text;
     hadError = true;
 }
 
+inline void reportHeld(const std::vector<std::string>& errors)
+{
+    for(const std::string& text : errors)
+    {
+        std::cerr << text;
+        hadError = true;
+    }
+}
+
 inline void error(const Token& token, std::string message) {
   if (token.type == TokenType::EoF) {
-    report(token.line, " at end", message);
+    report(token.line(), " at end", message);
   } else {
-    report(token.line, " at '" + token.lexeme + "'", message);
+    report(token.line(), " at '" + std::string(token.lexeme()) + "'", message);
   }
 }
 
@@ -28,10 +49,15 @@ inline void error(int line, std::string message)
     report(line, "", message);
 }
 
-inline void runtimeError(RuntimeError error)
+inline void runtimeError(int line, const std::string& message)
 {
-    std::cerr << error.what() << "\n[line " << error.token.line << "]\n";
+    std::cerr << message << "\n[line " << line << "]\n";
     hadRuntimeError = true;
 }
 
+inline void runtimeError(RuntimeError error)
+{
+    runtimeError(error.token.line(), error.what());
+}
+
 #endif // ERRORS_HPP
\ No newline at end of file
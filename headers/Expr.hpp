@@ -3,11 +3,12 @@
 #ifndef EXPR_HPP
 #define EXPR_HPP
 
-#include <any>
 #include <memory>
 #include <vector>
 #include <utility>
 #include "Token.hpp"
+#include "LoxValue.hpp"
+#include "PropertyCache.hpp"
 
 class Assign;
 class Binary;
@@ -22,195 +23,231 @@ class Set;
 class This;
 class Super;
 
+// Where the Resolver found a variable. Locals live at `slot` in the frame of
+// the running call; a local some function captures is BOXED, the frame slot
+// holding the LoxUpvalue it shares with those closures. A variable of an
+// enclosing function is reached through upvalue `slot` of the running
+// closure.
+struct LocalSlot
+{
+    enum class Kind : uint8_t
+    {
+        GLOBAL,
+        FRAME,
+        BOXED,
+        UPVALUE
+    };
+
+    Kind kind = Kind::GLOBAL;
+    int slot = -1;
+
+    bool isGlobal() const
+    {
+        return kind == Kind::GLOBAL;
+    }
+};
+
 class ExprVisitor
 {
 public:
-    virtual std::any visitAssignExpr(std::shared_ptr<Assign> expr) = 0;
-    virtual std::any visitBinaryExpr(std::shared_ptr<Binary> expr) = 0;
-    virtual std::any visitGroupingExpr(std::shared_ptr<Grouping> expr) = 0;
-    virtual std::any visitLiteralExpr(std::shared_ptr<Literal> expr) = 0;
-    virtual std::any visitUnaryExpr(std::shared_ptr<Unary> expr) = 0;
-    virtual std::any visitVariableExpr(std::shared_ptr<Variable> expr) = 0;
-    virtual std::any visitLogicalExpr(std::shared_ptr<Logical> expr) = 0;
-    virtual std::any visitCallExpr(std::shared_ptr<Call> expr) = 0;
-    virtual std::any visitGetExpr(std::shared_ptr<Get> expr) = 0;
-    virtual std::any visitSetExpr(std::shared_ptr<Set> expr) = 0;
-    virtual std::any visitThisExpr(std::shared_ptr<This> expr) = 0;
-    virtual std::any visitSuperExpr(std::shared_ptr<Super> epxr) = 0;
+    virtual LoxValue visitAssignExpr(Assign& expr) = 0;
+    virtual LoxValue visitBinaryExpr(Binary& expr) = 0;
+    virtual LoxValue visitGroupingExpr(Grouping& expr) = 0;
+    virtual LoxValue visitLiteralExpr(Literal& expr) = 0;
+    virtual LoxValue visitUnaryExpr(Unary& expr) = 0;
+    virtual LoxValue visitVariableExpr(Variable& expr) = 0;
+    virtual LoxValue visitLogicalExpr(Logical& expr) = 0;
+    virtual LoxValue visitCallExpr(Call& expr) = 0;
+    virtual LoxValue visitGetExpr(Get& expr) = 0;
+    virtual LoxValue visitSetExpr(Set& expr) = 0;
+    virtual LoxValue visitThisExpr(This& expr) = 0;
+    virtual LoxValue visitSuperExpr(Super& expr) = 0;
     virtual ~ExprVisitor() = default;
 };
 
 class Expr
 {
 public:
-    virtual std::any accept(ExprVisitor& visitor) = 0;
+    virtual LoxValue accept(ExprVisitor& visitor) = 0;
 };
 
-class Assign : public Expr, public std::enable_shared_from_this<Assign>
+class Assign : public Expr
 {
 public:
     Token name;
-    std::shared_ptr<Expr> value;
+    Expr* value;
+    LocalSlot local;
 public:
-    Assign(Token name, std::shared_ptr<Expr> value) : name(name), value(value) {}
-    std::any accept(ExprVisitor& visitor) override
+    Assign(Token name, Expr* value) : name(name), value(value) {}
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitAssignExpr(shared_from_this());
+        return visitor.visitAssignExpr(*this);
     }
 };
 
-class Binary : public Expr, public std::enable_shared_from_this<Binary>
+class Binary : public Expr
 {
 public:
-    std::shared_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::shared_ptr<Expr> right;
+    Expr* right;
 public:
-    Binary(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right) : left(left), op(op), right(right) {}
-    std::any accept(ExprVisitor& visitor) override
+    Binary(Expr* left, Token op, Expr* right) : left(left), op(op), right(right) {}
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitBinaryExpr(shared_from_this());
+        return visitor.visitBinaryExpr(*this);
     }
 };
 
-class Grouping : public Expr, public std::enable_shared_from_this<Grouping>
+class Grouping : public Expr
 {
 public:
-    std::shared_ptr<Expr> expression;
+    Expr* expression;
 public:
-    Grouping(std::shared_ptr<Expr> expression) : expression(expression) {}
-    std::any accept(ExprVisitor& visitor) override
+    Grouping(Expr* expression) : expression(expression) {}
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitGroupingExpr(shared_from_this());
+        return visitor.visitGroupingExpr(*this);
     }
 };
 
-class Literal : public Expr, public std::enable_shared_from_this<Literal>
+class Literal : public Expr
 {
 public:
-    std::any value;
+    LoxValue value;
 public:
-    Literal(std::any value) : value(value) {}
-    std::any accept(ExprVisitor& visitor) override
+    Literal(LoxValue value) : value(std::move(value)) {}
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitLiteralExpr(shared_from_this());
+        return visitor.visitLiteralExpr(*this);
     }
 };
 
-class Unary : public Expr, public std::enable_shared_from_this<Unary>
+class Unary : public Expr
 {
 public:
     Token op;
-    std::shared_ptr<Expr> right;
+    Expr* right;
 public:
-    Unary(Token op, std::shared_ptr<Expr> right) : op(op), right(right) {}
-    std::any accept(ExprVisitor& visitor) override
+    Unary(Token op, Expr* right) : op(op), right(right) {}
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitUnaryExpr(shared_from_this());
+        return visitor.visitUnaryExpr(*this);
     }
 };
 
-class Variable : public Expr, public std::enable_shared_from_this<Variable>
+class Variable : public Expr
 {
 public:
     Token name;
+    LocalSlot local;
 public:
     Variable(Token name) : name(name) {}
-    std::any accept(ExprVisitor& visitor) override
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitVariableExpr(shared_from_this());
+        return visitor.visitVariableExpr(*this);
     }
 };
 
-class Logical : public Expr, public std::enable_shared_from_this<Logical>
+class Logical : public Expr
 {
 public:
-    std::shared_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::shared_ptr<Expr> right;
+    Expr* right;
 
 public:
-    Logical(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right) : left {std::move(left)}, op {std::move(op)}, right {std::move(right)} {}
-    std::any accept(ExprVisitor& visitor) override 
+    Logical(Expr* left, Token op, Expr* right) : left {std::move(left)}, op {std::move(op)}, right {std::move(right)} {}
+    LoxValue accept(ExprVisitor& visitor) override 
     {
-        return visitor.visitLogicalExpr(shared_from_this());
+        return visitor.visitLogicalExpr(*this);
     }
 };
 
-class Call : public Expr, public std::enable_shared_from_this<Call>
+class Call : public Expr
 {
 public:
-    std::shared_ptr<Expr> callee;
+    Expr* callee;
     Token paren;
-    std::vector<std::shared_ptr<Expr>> arguments;
+    std::vector<Expr*> arguments;
+    // Set by the Parser when the callee is a property access, so a method
+    // can be invoked on its receiver without first binding it.
+    Get* property = nullptr;
 
 public:
-    Call(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> arguments) :
+    Call(Expr* callee, Token paren, std::vector<Expr*> arguments) :
         callee {std::move(callee)}, paren {std::move(paren)}, arguments {std::move(arguments)} {}
 
-    std::any accept(ExprVisitor& visitor) override 
+    LoxValue accept(ExprVisitor& visitor) override 
     {
-        return visitor.visitCallExpr(shared_from_this());
+        return visitor.visitCallExpr(*this);
     }
 };
 
-class Get : public Expr, public std::enable_shared_from_this<Get>
+class Get : public Expr
 {
 public:
-    std::shared_ptr<Expr> object;
+    Expr* object;
     Token name;
+    PropertyCache cache;
 
 public:
-    Get(std::shared_ptr<Expr> object, Token name) : object {std::move(object)}, name {std::move(name)} {}
+    Get(Expr* object, Token name) : object {std::move(object)}, name {std::move(name)} {}
     
-    std::any accept(ExprVisitor& visitor) override
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitGetExpr(shared_from_this());
+        return visitor.visitGetExpr(*this);
     }
 };
 
-class Set : public Expr, public std::enable_shared_from_this<Set>
+class Set : public Expr
 {
 public:
-    std::shared_ptr<Expr> object;
+    Expr* object;
     Token name;
-    std::shared_ptr<Expr> value;
+    Expr* value;
+    PropertyCache cache;
 
 public:
-    Set(std::shared_ptr<Expr> object, Token name, std::shared_ptr<Expr> value) : object {std::move(object)}, name {std::move(name)}, value {std::move(value)} {}
+    Set(Expr* object, Token name, Expr* value) : object {std::move(object)}, name {std::move(name)}, value {std::move(value)} {}
 
-    std::any accept(ExprVisitor& visitor) override
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitSetExpr(shared_from_this());
+        return visitor.visitSetExpr(*this);
     }
 };
 
-class This : public Expr, public std::enable_shared_from_this<This>
+class This : public Expr
 {
 public:
     Token keyword;
+    LocalSlot local;
 
 public:
     This(Token keyword) : keyword {std::move(keyword)} {}
 
-    std::any accept(ExprVisitor& visitor) override
+    LoxValue accept(ExprVisitor& visitor) override
     {
-        return visitor.visitThisExpr(shared_from_this());
+        return visitor.visitThisExpr(*this);
     }
 };
 
-class Super : public Expr, public std::enable_shared_from_this<Super> 
+class Super : public Expr 
 {
 public:
     Token keyword;
     Token method;
+    LocalSlot local;
+    // Where the enclosing method keeps "this".
+    LocalSlot thisLocal;
+    PropertyCache cache;
 
 public:
     Super(Token keyword, Token method) : keyword {std::move(keyword)}, method {std::move(method)} {}
 
-    std::any accept(ExprVisitor& visitor) override 
+    LoxValue accept(ExprVisitor& visitor) override 
     {
-        return visitor.visitSuperExpr(shared_from_this());
+        return visitor.visitSuperExpr(*this);
     }
 };
 
@@ -0,0 +1,84 @@
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+class LoxObject;
+
+struct HeapStats
+{
+    size_t collections = 0;
+    size_t minorCollections = 0;
+    size_t objectsFreed = 0;
+    size_t objectsPromoted = 0;
+    size_t bytesFreed = 0;
+};
+
+// Owner of the memory of every LoxObject and of the cycle collector.
+//
+// Small objects are carved out of 64KB chunks, one size class per chunk:
+// allocation pops the size class's free list or bumps a pointer through its
+// current chunk, and freeing pushes the cell back on the free list. Most
+// objects (upvalue boxes, temporary strings, bound methods) die almost
+// immediately, so their cells are reused while still in cache.
+//
+// Objects are freed by their reference count as soon as the last reference
+// goes away; what counting cannot free are cycles, such as a closure stored in
+// a variable it captured or an instance holding a method bound to itself.
+// Objects that can hold references (upvalues, functions, classes and
+// instances) are tracked, and collections mark-sweep them: references
+// between the objects being collected are subtracted from their counts,
+// whatever still has references left is held from elsewhere (globals, the
+// interpreter's frame stack, values on the C++ stack, caches in the AST,
+// older objects) and is a root, everything reachable from a root is marked,
+// and the rest is garbage whose references are cleared so the counts drop to
+// zero.
+//
+// Tracked objects start out young. A minor collection runs once enough young
+// objects have survived their reference counts, looks only at those, and
+// promotes the survivors to the old generation. Objects cannot move, so
+// promotion relinks them rather than copying. A full collection runs when the
+// heap has grown past `threshold` bytes.
+class Heap
+{
+public:
+    static constexpr size_t MAX_SMALL_SIZE = 512;
+
+    static void* allocate(size_t size);
+    static void deallocate(void* pointer, size_t size);
+    // For memory an object owns beyond its own allocation.
+    static void grow(size_t size) { bytesAllocated += size; }
+    static void shrink(size_t size) { bytesAllocated -= size; }
+
+    static void track(LoxObject* object);
+    static void untrack(LoxObject* object);
+
+    static void collect();
+    static void collectYoung();
+    static size_t size() { return bytesAllocated; }
+    static const HeapStats& stats() { return heapStats; }
+
+private:
+    class Unreference;
+    class Mark;
+
+    struct Generation
+    {
+        LoxObject* objects;
+        size_t count;
+    };
+
+    static inline Generation young {nullptr, 0};
+    static inline Generation old {nullptr, 0};
+    static inline size_t bytesAllocated = 0;
+    static inline size_t threshold = 1 << 20;
+    static inline bool collecting = false;
+    static inline HeapStats heapStats;
+
+    static void* allocateSmall(size_t size);
+    static void collect(Generation& generation);
+    static void promoteYoung();
+};
+
+#endif // HEAP_HPP
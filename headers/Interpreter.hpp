@@ -10,9 +10,12 @@
 #include "Environment.hpp"
 #include "LoxCallable.hpp"
 #include "LoxFunction.hpp"
-#include "LoxReturn.hpp"
 #include "LoxClass.hpp"
+#include "LoxString.hpp"
+#include "LoxUpvalue.hpp"
+#include "LoxValue.hpp"
 #include <any>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <memory>
@@ -21,60 +24,91 @@
 class NativeClock : public LoxCallable
 {
 public:
-    int arity()override;
-    std::any call(Interpreter& interpreter, std::vector<std::any> arguments) override;
+    NativeClock() : LoxCallable {ObjectType::NATIVE} {}
+    int arity() override;
+    LoxValue call(Interpreter& interpreter, std::vector<LoxValue> arguments) override;
     std::string toString() override;
 
 };
 
+// How a statement finished. A return statement leaves its value in the
+// Interpreter and reports RETURN so enclosing blocks and loops stop early,
+// instead of unwinding to the call with an exception.
+enum class Completion
+{
+    NORMAL,
+    RETURN
+};
+
 class Interpreter : public ExprVisitor, public StmtVisitor
 {
 public:
+    static constexpr int FRAME_STACK_MAX = 1 << 16;
+
     Interpreter();
-    void interpret(std::vector<std::shared_ptr<Stmt>> statements);
-    void executeBlock(std::vector<std::shared_ptr<Stmt>> statements, std::shared_ptr<Environment> environment);
-    void resolve(std::shared_ptr<Expr> expr, int depth);
+    void interpret(const std::vector<Stmt*>& statements, int frameSize);
+    Completion executeCall(Function* declaration, const Ref<LoxUpvalue>* upvalues, LoxInstance* receiver, std::vector<LoxValue> arguments);
+    LoxValue takeReturnValue();
 
-    std::any visitLiteralExpr(std::shared_ptr<Literal> expr) override;
-    std::any visitGroupingExpr(std::shared_ptr<Grouping> expr) override;
-    std::any visitUnaryExpr(std::shared_ptr<Unary> expr) override;
-    std::any visitBinaryExpr(std::shared_ptr<Binary> expr) override;
-    std::any visitVariableExpr(std::shared_ptr<Variable> expr) override;
-    std::any visitAssignExpr(std::shared_ptr<Assign> expr) override;
-    std::any visitLogicalExpr(std::shared_ptr<Logical> expr) override;
-    std::any visitCallExpr(std::shared_ptr<Call> expr) override;
-    std::any visitGetExpr(std::shared_ptr<Get> expr) override;
-    std::any visitSetExpr(std::shared_ptr<Set> expr) override;
-    std::any visitThisExpr(std::shared_ptr<This> expr) override;
-    std::any visitSuperExpr(std::shared_ptr<Super> expr) override;
+    LoxValue visitLiteralExpr(Literal& expr) override;
+    LoxValue visitGroupingExpr(Grouping& expr) override;
+    LoxValue visitUnaryExpr(Unary& expr) override;
+    LoxValue visitBinaryExpr(Binary& expr) override;
+    LoxValue visitVariableExpr(Variable& expr) override;
+    LoxValue visitAssignExpr(Assign& expr) override;
+    LoxValue visitLogicalExpr(Logical& expr) override;
+    LoxValue visitCallExpr(Call& expr) override;
+    LoxValue visitGetExpr(Get& expr) override;
+    LoxValue visitSetExpr(Set& expr) override;
+    LoxValue visitThisExpr(This& expr) override;
+    LoxValue visitSuperExpr(Super& expr) override;
 
-    std::any visitBlockStmt(std::shared_ptr<Block> expr) override;
-    std::any visitExpressionStmt(std::shared_ptr<Expression> expr) override;
-    std::any visitPrintStmt(std::shared_ptr<Print> expr) override;
-    std::any visitVarStmt(std::shared_ptr<Var> expr) override;
-    std::any visitIfStmt(std::shared_ptr<If> expr) override;
-    std::any visitWhileStmt(std::shared_ptr<While> expr) override;
-    std::any visitFunctionStmt(std::shared_ptr<Function> expr) override;
-    std::any visitReturnStmt(std::shared_ptr<Return> expr) override;
-    std::any visitClassStmt(std::shared_ptr<Class> stmt) override;
+    void visitBlockStmt(Block& expr) override;
+    void visitExpressionStmt(Expression& expr) override;
+    void visitPrintStmt(Print& expr) override;
+    void visitVarStmt(Var& expr) override;
+    void visitIfStmt(If& expr) override;
+    void visitWhileStmt(While& expr) override;
+    void visitFunctionStmt(Function& expr) override;
+    void visitReturnStmt(Return& expr) override;
+    void visitClassStmt(Class& stmt) override;
 
 public:
-    std::shared_ptr<Environment> globals{new Environment};
+    Environment globals;
     
 
 private:
-    std::shared_ptr<Environment> environment = globals;
-    std::map<std::shared_ptr<Expr>, int> locals;
-    std::any evaluate(std::shared_ptr<Expr> expr);
-    bool isTruthy(std::any object);
-    bool isEqual(const std::any &a, const std::any &b);
+    struct FrameScope
+    {
+        Interpreter& interpreter;
+        LoxValue* previousFrame;
+        const Ref<LoxUpvalue>* previousUpvalues;
+        ~FrameScope();
+    };
+
+    // Locals of the scopes no function captures, for every active call.
+    // `frame` is where the slots of the running call start.
+    std::unique_ptr<LoxValue[]> frameStack {new LoxValue[FRAME_STACK_MAX]};
+    LoxValue* frame = frameStack.get();
+    LoxValue* frameTop = frameStack.get();
+    // Upvalues of the running closure.
+    const Ref<LoxUpvalue>* upvalues = nullptr;
+    Completion completion = Completion::NORMAL;
+    LoxValue returnValue;
+    LoxValue evaluate(Expr* expr);
+    LoxValue invoke(Call& expr, Get& property);
+    LoxValue call(const LoxValue& callee, Call& expr);
+    std::vector<LoxValue> evaluateArguments(Call& expr);
+    void checkArity(Call& expr, LoxCallable* function, int argumentCount);
 
-    void checkNumberOperand(Token op, std::any operand);
-    void checkNumberOperands(Token op, std::any left, std::any right);
+    void checkNumberOperand(const Token& op, const LoxValue& operand);
+    void checkNumberOperands(const Token& op, const LoxValue& left, const LoxValue& right);
 
-    std::string stringify(std::any object);
-    void execute(std::shared_ptr<Stmt> stmt);
-    std::any lookUpVariable(Token& name, std::shared_ptr<Expr> expr);
+    Completion execute(Stmt* stmt);
+    LoxValue lookUpVariable(const Token& name, const LocalSlot& local);
+    void define(const LocalSlot& local, const Token& name, LoxValue value);
+    void assign(const LocalSlot& local, const Token& name, LoxValue value);
+    Ref<LoxFunction> closure(Function* declaration, bool isInitializer);
 
 };
 
@@ -1,21 +1,38 @@
 #ifndef LOX_HPP
 #define LOX_HPP
 
+#include <memory>
 #include <string>
 
+class Source;
+
 namespace TWI
 {
+    enum class Backend
+    {
+        TREE_WALKER,
+        BYTECODE_VM
+    };
+
     class Lox
     {
         public:
-            Lox();
+            // A streaming Lox runs each top-level declaration of a program as
+            // soon as it has been parsed, rather than after the whole program.
+            // With scanThread, programs are scanned on a thread of their own
+            // while they are parsed.
+            Lox(Backend backend = Backend::TREE_WALKER, bool streaming = false, bool scanThread = false);
             void runFile(std::string path);
             void runPrompt();
             void run(std::string source);
 
         private:
-            std::string readFile(std::string path);
-            bool hadError;
+            Backend backend;
+            bool streaming;
+            bool scanThread;
+
+            void run(std::unique_ptr<Source> source);
+            void runStreaming(std::unique_ptr<Source> source);
     };
 }
 
@@ -1,19 +1,19 @@
 #ifndef LOXCALLABLE_HPP
 #define LOXCALLABLE_HPP
 
-#include <any>
 #include <string>
 #include <vector>
+#include "LoxObject.hpp"
+#include "LoxValue.hpp"
 
 class Interpreter;
 
-class LoxCallable
+class LoxCallable : public LoxObject
 {
 public:
+    LoxCallable(ObjectType objectType) : LoxObject {objectType} {}
     virtual int arity() = 0;
-    virtual std::any call(Interpreter& interpreter, std::vector<std::any> arguments) = 0;
-    virtual std::string toString() = 0;
-    virtual ~LoxCallable() = default;
+    virtual LoxValue call(Interpreter& interpreter, std::vector<LoxValue> arguments) = 0;
 };
 
-#endif // LOXCALLABLE_HPP
\ No newline at end of file
+#endif // LOXCALLABLE_HPP
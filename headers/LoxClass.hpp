@@ -6,26 +6,34 @@
 #include "LoxFunction.hpp"
 #include <string>
 #include <utility>
-#include <any>
-#include <map>
+#include <unordered_map>
+#include "LoxString.hpp"
+#include "Shape.hpp"
 
 class LoxFunction;
 
-class LoxClass : public LoxCallable, public std::enable_shared_from_this<LoxClass> 
+class LoxClass : public LoxCallable
 {
 public:
     std::string name;
-    std::shared_ptr<LoxClass> superclass;
+    Ref<LoxClass> superclass;
+    // Shape of a new instance, before any field is assigned.
+    Shape rootShape;
+    // Largest field count any instance has reached. New instances reserve
+    // this many inline field slots.
+    int fieldCapacity = 0;
 
 private:
-    std::map<std::string, std::shared_ptr<LoxFunction>> methods;
+    std::unordered_map<Ref<LoxString>, Ref<LoxFunction>> methods;
 
 public:
-    LoxClass(std::string name, std::shared_ptr<LoxClass> superclass, std::map<std::string, std::shared_ptr<LoxFunction>> methods) : name {std::move(name)}, superclass {std::move(superclass)}, methods {std::move(methods)} {}
+    LoxClass(std::string name, Ref<LoxClass> superclass, std::unordered_map<Ref<LoxString>, Ref<LoxFunction>> methods) : LoxCallable {ObjectType::CLASS}, name {std::move(name)}, superclass {std::move(superclass)}, methods {std::move(methods)} {}
     std::string toString() override;
+    void trace(Tracer& tracer) override;
+    void clearReferences() override;
     int arity() override;
-    std::any call(Interpreter& interpreter, std::vector<std::any> arguments) override;
-    std::shared_ptr<LoxFunction> findMethod(std::string name);
+    LoxValue call(Interpreter& interpreter, std::vector<LoxValue> arguments) override;
+    LoxFunction* findMethod(const Ref<LoxString>& name);
 };
 
-#endif // LOXCLASS_HPP
\ No newline at end of file
+#endif // LOXCLASS_HPP
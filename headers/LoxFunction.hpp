@@ -1,30 +1,38 @@
 #ifndef LOXFUNCTION_HPP
 #define LOXFUNCTION_HPP
 
-#include <any>
 #include <memory>
 #include <string>
 #include <vector>
 #include "LoxCallable.hpp"
 #include "LoxInstance.hpp"
+#include "LoxUpvalue.hpp"
 
-class Environment;
 class Function;
 class LoxInstance;
 
 class LoxFunction : public LoxCallable
 {
 public:
-    std::shared_ptr<Function> declaration;
-    std::shared_ptr<Environment> closure;
+    // Owned by the AstArena of the program that declared the function.
+    Function* declaration;
+    // The boxes of the captured variables, laid out as in
+    // `declaration->upvalues`.
+    std::vector<Ref<LoxUpvalue>> upvalues;
     bool isInitializer;
+    // The instance a method was bound to; null for functions and for the
+    // unbound methods stored in a class.
+    Ref<LoxInstance> receiver;
 
 public:
-    LoxFunction(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure, bool isInitializer);
+    LoxFunction(Function* declaration, std::vector<Ref<LoxUpvalue>> upvalues, bool isInitializer, Ref<LoxInstance> receiver = nullptr);
     int arity() override;
     std::string toString() override;
-    std::any call(Interpreter& interpreter, std::vector<std::any> arguments) override;
-    std::shared_ptr<LoxFunction> bind(std::shared_ptr<LoxInstance> instance);
+    void trace(Tracer& tracer) override;
+    void clearReferences() override;
+    LoxValue call(Interpreter& interpreter, std::vector<LoxValue> arguments) override;
+    LoxValue invoke(Interpreter& interpreter, LoxInstance* receiver, std::vector<LoxValue> arguments);
+    Ref<LoxFunction> bind(LoxInstance* instance);
 };
 
-#endif // LOXFUNCTION_HPP
\ No newline at end of file
+#endif // LOXFUNCTION_HPP
@@ -3,30 +3,70 @@
 
 
 #include "LoxClass.hpp"
+#include "LoxObject.hpp"
+#include "LoxValue.hpp"
 #include "Token.hpp"
 #include "Errors.hpp"
+#include "PropertyCache.hpp"
+#include "Shape.hpp"
+#include "Heap.hpp"
 
-#include <any>
-#include <map>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <string>
 #include <utility>
 
 class LoxClass;
 class Token;
 
-class LoxInstance: public std::enable_shared_from_this<LoxInstance> 
+// Field values live in a contiguous array laid out by `shape`. The array
+// starts out inline, directly after the object, sized by how many fields
+// earlier instances of the class ended up with; it moves to the heap only if
+// this instance outgrows that.
+class LoxInstance : public LoxObject
 {
 public:
-  std::shared_ptr<LoxClass> klass;
-  std::map<std::string, std::any> fields;
+  Ref<LoxClass> klass;
+  Shape* shape;
+
+private:
+  struct InlineFields
+  {
+    uint32_t capacity;
+  };
+
+  LoxValue* fields;
+  uint32_t capacity;
+  const uint32_t inlineCapacity;
+  std::unique_ptr<LoxValue[]> spilled;
 
 public:
-  LoxInstance(std::shared_ptr<LoxClass> klass) : klass {std::move(klass)} {}
-  std::string toString();
-  std::any get(Token& name);
-  std::any set(Token& name, std::any value);
+  static Ref<LoxInstance> create(Ref<LoxClass> klass);
+  ~LoxInstance() override;
+  std::string toString() override;
+  void trace(Tracer& tracer) override;
+  void clearReferences() override;
+  LoxValue get(const Token& name, PropertyCache& cache);
+  LoxFunction* getMethod(const Token& name, PropertyCache& cache);
+  void set(const Token& name, LoxValue value, PropertyCache& cache);
+
+  // The Heap finds the size including the inline fields from the pointer.
+  static void operator delete(void* pointer, size_t size) { Heap::deallocate(pointer, size); }
+
+private:
+  LoxInstance(Ref<LoxClass> klass, uint32_t inlineCapacity);
+  void lookUp(const Token& name, PropertyCache& cache);
+  void addField(Shape* next, LoxValue value);
+
+  static void* operator new(size_t size, InlineFields inlineFields)
+  {
+    return Heap::allocate(size + inlineFields.capacity * sizeof(LoxValue));
+  }
+
+  static void operator delete(void* pointer, InlineFields) { Heap::deallocate(pointer, sizeof(LoxInstance)); }
 };
 
 
-#endif
\ No newline at end of file
+#endif
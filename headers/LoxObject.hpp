@@ -0,0 +1,219 @@
+#ifndef LOXOBJECT_HPP
+#define LOXOBJECT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include "Heap.hpp"
+
+enum class ObjectType : uint8_t
+{
+    STRING,
+    UPVALUE,
+    FUNCTION,
+    NATIVE,
+    CLASS,
+    INSTANCE,
+    VM_FUNCTION,
+    VM_NATIVE,
+    VM_UPVALUE,
+    VM_CLOSURE,
+    VM_CLASS,
+    VM_INSTANCE,
+    VM_BOUND_METHOD
+};
+
+class LoxObject;
+class LoxValue;
+
+// Called by the Heap on every reference a tracked object holds, null or not.
+class Tracer
+{
+public:
+    virtual void visit(LoxObject* object) = 0;
+    void visit(const LoxValue& value);
+};
+
+// Base of every heap-allocated Lox runtime object. Objects are reference
+// counted intrusively; the interpreter is single threaded so the count is a
+// plain integer rather than an atomic. Objects that can reference others are
+// also tracked by the Heap, which collects the cycles counting cannot free.
+class LoxObject
+{
+public:
+    const ObjectType objectType;
+    uint32_t refCount = 0;
+
+private:
+    friend class Heap;
+
+    enum class GCState : uint8_t
+    {
+        UNTRACKED,
+        YOUNG,
+        OLD,
+        COLLECTING,
+        REACHABLE
+    };
+
+    GCState gcState = GCState::UNTRACKED;
+    uint32_t gcRefs = 0;
+    LoxObject* gcPrev = nullptr;
+    LoxObject* gcNext = nullptr;
+
+public:
+    LoxObject(ObjectType objectType) : objectType {objectType}
+    {
+        if(canReferenceObjects(objectType))
+        {
+            Heap::track(this);
+        }
+    }
+
+    LoxObject(const LoxObject&) = delete;
+    LoxObject& operator=(const LoxObject&) = delete;
+    virtual std::string toString() = 0;
+
+    virtual ~LoxObject()
+    {
+        if(gcState != GCState::UNTRACKED)
+        {
+            Heap::untrack(this);
+        }
+    }
+
+    // A tracked object must visit every reference it holds exactly once and
+    // be able to drop them all.
+    virtual void trace(Tracer& tracer) {}
+    virtual void clearReferences() {}
+
+    static void* operator new(size_t size) { return Heap::allocate(size); }
+    static void operator delete(void* pointer, size_t size) { Heap::deallocate(pointer, size); }
+
+private:
+    // Strings, natives and compiled functions only refer to strings and other
+    // functions, so they cannot be part of a cycle.
+    static bool canReferenceObjects(ObjectType objectType)
+    {
+        switch(objectType)
+        {
+        case ObjectType::UPVALUE:
+        case ObjectType::FUNCTION:
+        case ObjectType::CLASS:
+        case ObjectType::INSTANCE:
+        case ObjectType::VM_UPVALUE:
+        case ObjectType::VM_CLOSURE:
+        case ObjectType::VM_CLASS:
+        case ObjectType::VM_INSTANCE:
+        case ObjectType::VM_BOUND_METHOD:
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+inline void Heap::track(LoxObject* object)
+{
+    object->gcState = LoxObject::GCState::YOUNG;
+    object->gcNext = young.objects;
+    if(young.objects != nullptr)
+    {
+        young.objects->gcPrev = object;
+    }
+    young.objects = object;
+    young.count++;
+}
+
+inline void Heap::untrack(LoxObject* object)
+{
+    Generation& generation = object->gcState == LoxObject::GCState::OLD ? old : young;
+    if(object->gcPrev != nullptr)
+    {
+        object->gcPrev->gcNext = object->gcNext;
+    }
+    else
+    {
+        generation.objects = object->gcNext;
+    }
+    if(object->gcNext != nullptr)
+    {
+        object->gcNext->gcPrev = object->gcPrev;
+    }
+    object->gcState = LoxObject::GCState::UNTRACKED;
+    generation.count--;
+}
+
+inline void retainObject(LoxObject* object)
+{
+    if(object != nullptr)
+    {
+        object->refCount++;
+    }
+}
+
+inline void releaseObject(LoxObject* object)
+{
+    if(object != nullptr && --object->refCount == 0)
+    {
+        delete object;
+    }
+}
+
+// Owning handle to a LoxObject subclass.
+template <class T>
+class Ref
+{
+private:
+    T* pointer = nullptr;
+
+    template <class U>
+    friend class Ref;
+
+public:
+    Ref() = default;
+    Ref(std::nullptr_t) {}
+    explicit Ref(T* pointer) : pointer {pointer} { retainObject(pointer); }
+    Ref(const Ref& other) noexcept : pointer {other.pointer} { retainObject(pointer); }
+    Ref(Ref&& other) noexcept : pointer {other.pointer} { other.pointer = nullptr; }
+
+    template <class U>
+    Ref(const Ref<U>& other) noexcept : pointer {other.pointer} { retainObject(pointer); }
+
+    ~Ref() { releaseObject(pointer); }
+
+    Ref& operator=(Ref other) noexcept
+    {
+        std::swap(pointer, other.pointer);
+        return *this;
+    }
+
+    T* get() const { return pointer; }
+    T* operator->() const { return pointer; }
+    T& operator*() const { return *pointer; }
+    explicit operator bool() const { return pointer != nullptr; }
+    bool operator==(std::nullptr_t) const { return pointer == nullptr; }
+    bool operator!=(std::nullptr_t) const { return pointer != nullptr; }
+    bool operator==(const Ref& other) const { return pointer == other.pointer; }
+    bool operator!=(const Ref& other) const { return pointer != other.pointer; }
+};
+
+// Refs hash by identity, so an interned LoxString can key a map directly.
+namespace std
+{
+    template <class T>
+    struct hash<Ref<T>>
+    {
+        size_t operator()(const Ref<T>& ref) const { return hash<T*> {}(ref.get()); }
+    };
+}
+
+template <class T, class... Args>
+Ref<T> makeObject(Args&&... args)
+{
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
+
+#endif // LOXOBJECT_HPP
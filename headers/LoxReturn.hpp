@@ -1,14 +0,0 @@
-#ifndef LOXRETURN_HPP
-#define LOXRETURN_HPP
-
-#include <any>
-
-class LoxReturn
-{
-public:
-    const std::any value;
-public:
-    LoxReturn(std::any value) : value(value) {}
-};
-
-#endif // LOXRETURN_HPP
\ No newline at end of file
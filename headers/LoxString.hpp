@@ -0,0 +1,76 @@
+#ifndef LOXSTRING_HPP
+#define LOXSTRING_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "LoxObject.hpp"
+
+// Identifiers, string literals and every other string a name can be looked
+// up by are interned: there is at most one live interned string with given
+// characters, so they compare and hash by identity. The intern table does not
+// keep strings alive; a string removes itself from it when freed.
+//
+// Strings built by concatenation are not interned. Appending to such a string
+// extends its buffer in place when nothing has been appended to it yet, and
+// the result shares that buffer with a longer length, so a string built up in
+// a loop takes amortized linear time instead of copying itself every step.
+class LoxString : public LoxObject
+{
+private:
+    // The characters, unless `base` holds them. May run past `length` when
+    // longer strings were appended onto this one.
+    std::string buffer;
+    Ref<LoxString> base;
+    const size_t length;
+    const bool interned;
+    // The string's index in TokenLiterals while tokens refer to it.
+    uint32_t literal = 0;
+    // How much of `buffer`'s storage the Heap has been told about.
+    size_t bufferBytes = 0;
+
+    friend class TokenLiterals;
+
+public:
+    static Ref<LoxString> intern(std::string_view chars);
+    static Ref<LoxString> concat(LoxString* left, LoxString* right);
+    ~LoxString() override;
+
+    std::string_view chars() const
+    {
+        const std::string& characters = base != nullptr ? base->buffer : buffer;
+        return std::string_view {characters.data(), length};
+    }
+
+    bool equals(const LoxString* other) const
+    {
+        if(this == other)
+        {
+            return true;
+        }
+        if(interned && other->interned)
+        {
+            return false;
+        }
+        return chars() == other->chars();
+    }
+
+    std::string toString() override
+    {
+        return std::string {chars()};
+    }
+
+private:
+    LoxString(std::string chars, bool interned) : LoxObject {ObjectType::STRING}, buffer {std::move(chars)}, length {buffer.size()}, interned {interned}
+    {
+        accountBuffer();
+    }
+    LoxString(Ref<LoxString> base, size_t length) : LoxObject {ObjectType::STRING}, base {std::move(base)}, length {length}, interned {false} {}
+
+    // Counts the characters toward the Heap's size, so that building long
+    // strings brings on collections the way allocating objects does.
+    void accountBuffer();
+};
+
+#endif // LOXSTRING_HPP
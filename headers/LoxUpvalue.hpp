@@ -0,0 +1,37 @@
+#ifndef LOXUPVALUE_HPP
+#define LOXUPVALUE_HPP
+
+#include <string>
+#include <utility>
+#include "LoxObject.hpp"
+#include "LoxValue.hpp"
+
+// Box holding a local that a closure captures. The frame slot of the
+// declaring call and every closure capturing the local share the box, so
+// assignments on either side are seen by the other and the value outlives
+// the call.
+class LoxUpvalue : public LoxObject
+{
+public:
+    LoxValue value;
+
+public:
+    LoxUpvalue(LoxValue value) : LoxObject {ObjectType::UPVALUE}, value {std::move(value)} {}
+
+    std::string toString() override
+    {
+        return "upvalue";
+    }
+
+    void trace(Tracer& tracer) override
+    {
+        tracer.visit(value);
+    }
+
+    void clearReferences() override
+    {
+        value = nullptr;
+    }
+};
+
+#endif // LOXUPVALUE_HPP
@@ -0,0 +1,159 @@
+#ifndef LOXVALUE_HPP
+#define LOXVALUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "LoxObject.hpp"
+
+// A runtime Lox value: nil, a boolean, a double or a reference to a heap
+// object, discriminated by an inline tag. Fits in 16 bytes so values can be
+// passed and stored without any boxing.
+class LoxValue
+{
+public:
+    enum class Type : uint8_t
+    {
+        NIL,
+        BOOL,
+        NUMBER,
+        OBJECT
+    };
+
+private:
+    Type type;
+    union
+    {
+        bool boolean;
+        double number;
+        LoxObject* object;
+    } as;
+
+public:
+    LoxValue() : type {Type::NIL} { as.object = nullptr; }
+    LoxValue(std::nullptr_t) : LoxValue() {}
+    LoxValue(bool boolean) : type {Type::BOOL} { as.number = 0; as.boolean = boolean; }
+    LoxValue(double number) : type {Type::NUMBER} { as.number = number; }
+    LoxValue(const char*) = delete;
+
+    LoxValue(LoxObject* object) : type {object != nullptr ? Type::OBJECT : Type::NIL}
+    {
+        as.object = object;
+        retainObject(object);
+    }
+
+    template <class T>
+    LoxValue(const Ref<T>& object) : LoxValue(static_cast<LoxObject*>(object.get())) {}
+
+    LoxValue(const LoxValue& other) : type {other.type}, as {other.as}
+    {
+        if(type == Type::OBJECT)
+        {
+            retainObject(as.object);
+        }
+    }
+
+    LoxValue(LoxValue&& other) noexcept : type {other.type}, as {other.as}
+    {
+        other.type = Type::NIL;
+        other.as.object = nullptr;
+    }
+
+    // Both assignments read the incoming value before releasing the old one:
+    // releasing may free the object that owns `other`.
+    LoxValue& operator=(const LoxValue& other)
+    {
+        Type newType = other.type;
+        auto newAs = other.as;
+        if(newType == Type::OBJECT)
+        {
+            retainObject(newAs.object);
+        }
+        if(type == Type::OBJECT)
+        {
+            releaseObject(as.object);
+        }
+        type = newType;
+        as = newAs;
+        return *this;
+    }
+
+    LoxValue& operator=(LoxValue&& other) noexcept
+    {
+        Type newType = other.type;
+        auto newAs = other.as;
+        other.type = Type::NIL;
+        other.as.object = nullptr;
+        if(type == Type::OBJECT)
+        {
+            releaseObject(as.object);
+        }
+        type = newType;
+        as = newAs;
+        return *this;
+    }
+
+    ~LoxValue()
+    {
+        if(type == Type::OBJECT)
+        {
+            releaseObject(as.object);
+        }
+    }
+
+    Type getType() const { return type; }
+
+    bool isNil() const { return type == Type::NIL; }
+    bool isBool() const { return type == Type::BOOL; }
+    bool isNumber() const { return type == Type::NUMBER; }
+    bool isObject() const { return type == Type::OBJECT; }
+
+    bool isObject(ObjectType objectType) const
+    {
+        return type == Type::OBJECT && as.object->objectType == objectType;
+    }
+
+    bool isString() const { return isObject(ObjectType::STRING); }
+    bool isClass() const { return isObject(ObjectType::CLASS); }
+    bool isInstance() const { return isObject(ObjectType::INSTANCE); }
+
+    bool isCallable() const
+    {
+        return isObject(ObjectType::FUNCTION) || isObject(ObjectType::NATIVE) || isObject(ObjectType::CLASS);
+    }
+
+    bool asBool() const { return as.boolean; }
+    double asNumber() const { return as.number; }
+    LoxObject* asObject() const { return as.object; }
+
+    template <class T>
+    T* asObject() const { return static_cast<T*>(as.object); }
+
+    bool isTruthy() const
+    {
+        if(type == Type::NIL)
+        {
+            return false;
+        }
+        if(type == Type::BOOL)
+        {
+            return as.boolean;
+        }
+        return true;
+    }
+
+    bool equals(const LoxValue& other) const;
+    std::string toString() const;
+};
+
+inline void Tracer::visit(const LoxValue& value)
+{
+    if(value.isObject())
+    {
+        visit(value.asObject());
+    }
+}
+
+static_assert(sizeof(LoxValue) == 16, "LoxValue must stay 16 bytes");
+
+#endif // LOXVALUE_HPP
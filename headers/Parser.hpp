@@ -6,12 +6,16 @@
 #include "Expr.hpp"
 #include "Errors.hpp"
 #include "Stmt.hpp"
+#include "TokenSource.hpp"
+#include "LoxString.hpp"
+#include "AstArena.hpp"
 #include <vector>
 #include <memory>
 #include <utility>
 #include <stdexcept>
 #include <string>
 #include <cassert>
+#include <charconv>
 
 class Parser
 {
@@ -21,51 +25,94 @@ class Parser
     };
 
 private:
-    std::vector<Token> tokens;
-    int current = 0;
+    TokenSource& tokenSource;
+    // The parser never looks further back than the last token it consumed or
+    // further ahead than the next one, so those two are all it keeps of the
+    // token stream. The next token is pulled from the source when first
+    // looked at.
+    Token previousToken;
+    Token currentToken;
+    bool pulled = false;
+    AstArena* arena;
+    size_t functions = 0;
+
+    // Syntax errors are held back until reportErrors(), so that they come
+    // after every lexical error as when the whole program was scanned before
+    // parsing began.
+    struct SyntaxError
+    {
+        int line;
+        std::string where;
+        std::string message;
+    };
+    std::vector<SyntaxError> syntaxErrors;
 
 public:
-    Parser(std::vector<Token> tokens);
-    std::vector<std::shared_ptr<Stmt>> parse();
+    Parser(TokenSource& tokenSource, AstArena& arena);
+    Parser(const Parser&) = delete;
+    Parser& operator=(const Parser&) = delete;
+    ~Parser();
+    std::vector<Stmt*> parse();
+    // Parses the next top-level declaration into `arena`, so a program can be
+    // run one declaration at a time as it is parsed. Returns null if the
+    // declaration has a syntax error.
+    Stmt* parseDeclaration(AstArena& arena);
+    bool isAtEnd();
+    bool hadSyntaxError() const { return !syntaxErrors.empty(); }
+    // Reports the syntax errors found since the last call. parse() reports
+    // them once it reaches the end of the program.
+    void reportErrors();
+    // How many function and method declarations have been parsed so far.
+    size_t functionCount() const { return functions; }
 
 private:
-    std::shared_ptr<Expr> expression();
-    std::shared_ptr<Expr> equality();
-    std::shared_ptr<Expr> comparison();
-    std::shared_ptr<Expr> term();
-    std::shared_ptr<Expr> factor();
-    std::shared_ptr<Expr> unary();
-    std::shared_ptr<Expr> primary();
-    std::shared_ptr<Expr> assignment();
+    // How tightly an operator binds, loosest first.
+    enum class Precedence
+    {
+        NONE,
+        ASSIGNMENT,
+        OR,
+        AND,
+        EQUALITY,
+        COMPARISON,
+        TERM,
+        FACTOR,
+        UNARY,
+        CALL
+    };
+
+    Expr* expression();
+    Expr* expression(Precedence precedence);
+    static Precedence infixPrecedence(TokenType type);
+    static Precedence tighter(Precedence precedence);
+    Expr* assignment(Expr* target, const Token& equals);
+    Expr* prefix();
+    double number(const Token& token);
 
     Token consume(TokenType type, std::string message);
-    ParseError error(Token token, std::string message);
+    ParseError error(const Token& token, std::string message);
 
     template <class... T>
     bool match(T... type);
 
     bool check(TokenType type);
     Token advance();
-    bool isAtEnd();
-    Token peek();
+    const Token& peek();
     Token previous();
     void synchronize();
-    std::shared_ptr<Stmt> statement();
-    std::shared_ptr<Stmt> printStatement();
-    std::shared_ptr<Stmt> expressionStatement();
-    std::shared_ptr<Stmt> declaration();
-    std::shared_ptr<Stmt> varDeclaration();
-    std::vector<std::shared_ptr<Stmt>> block();
-    std::shared_ptr<Stmt> ifStatement();
-    std::shared_ptr<Stmt> whileStatement();
-    std::shared_ptr<Stmt> forStatement();
-    std::shared_ptr<Expr> _or();
-    std::shared_ptr<Expr> _and();
-    std::shared_ptr<Expr> call();
-    std::shared_ptr<Expr> finishCall(std::shared_ptr<Expr> callee);
-    std::shared_ptr<Function> function(std::string kind);
-    std::shared_ptr<Stmt> returnStatement();
-    std::shared_ptr<Stmt> classDeclaration();
+    Stmt* statement();
+    Stmt* printStatement();
+    Stmt* expressionStatement();
+    Stmt* declaration();
+    Stmt* varDeclaration();
+    std::vector<Stmt*> block();
+    Stmt* ifStatement();
+    Stmt* whileStatement();
+    Stmt* forStatement();
+    Expr* finishCall(Expr* callee);
+    Function* function(std::string kind);
+    Stmt* returnStatement();
+    Stmt* classDeclaration();
 };
 
 #endif // PARSER_HPP
@@ -0,0 +1,25 @@
+#ifndef PROPERTYCACHE_HPP
+#define PROPERTYCACHE_HPP
+
+#include "LoxObject.hpp"
+
+class LoxFunction;
+class Shape;
+
+// Inline cache kept on each Get, Set and Super node. It remembers what the
+// property name resolved to for the last receiver layout seen at that site,
+// so a monomorphic site reaches the field or method without any name lookup.
+// Get and Set are keyed by the instance's Shape, Super by the superclass.
+// Holding a reference to the class keeps its shapes and methods alive.
+struct PropertyCache
+{
+    Ref<LoxObject> klass;
+    const Shape* shape = nullptr;
+    // Offset of the field in `shape`, or -1 if the shape has no such field.
+    int field = -1;
+    // For Set: the shape to move to when `shape` lacks the field.
+    Shape* transition = nullptr;
+    LoxFunction* method = nullptr;
+};
+
+#endif // PROPERTYCACHE_HPP
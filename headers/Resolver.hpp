@@ -2,19 +2,52 @@
 #define RESOLVER_HPP
 
 #include <memory>
-#include <map>
+#include <unordered_map>
 
 #include "Expr.hpp"
 #include "Stmt.hpp"
-#include "Interpreter.hpp"
+#include "Errors.hpp"
 #include "Token.hpp"
+#include "LoxString.hpp"
 
 
 class Resolver : public ExprVisitor, public StmtVisitor
 {
 private:
-    Interpreter& interpreter;
-    std::vector<std::map<std::string, bool>> scopes;
+    struct Local
+    {
+        int slot;
+        bool defined;
+        // Set when a nested function refers to the local, which then has to
+        // outlive the call in a box.
+        bool captured = false;
+    };
+
+    // A use or declaration of a local in the function declaring it. Whether
+    // the local is boxed is only known once its scope ends, so the reference
+    // waits in that scope until then.
+    struct Reference
+    {
+        LocalSlot* local;
+        const Local* variable;
+    };
+
+    struct Scope
+    {
+        // Keyed by interned name; the AST holds the names alive.
+        std::unordered_map<const LoxString*, Local> locals;
+        // Nesting level of the function the scope belongs to; 0 outside any.
+        int function;
+        int frameBase;
+        std::vector<Reference> references;
+    };
+
+    std::vector<Scope> scopes;
+    // Functions being resolved, indexed by nesting level; level 0 is the top
+    // level and has no Function.
+    std::vector<Function*> functions {nullptr};
+    // Frame slots used so far by the innermost function, or by the top level.
+    int frameSize = 0;
 
     enum class FunctionType
     {
@@ -34,41 +67,49 @@ private:
     FunctionType currentFunction = FunctionType::NONE;
     ClassType currentClass = ClassType::NONE;
 
+    const Ref<LoxString> thisSymbol = LoxString::intern("this");
+    const Ref<LoxString> superSymbol = LoxString::intern("super");
+
 public:
-    Resolver(Interpreter& interpreter) : interpreter {interpreter} {}
 
-    std::any visitBlockStmt(std::shared_ptr<Block> stmt) override;
-    std::any visitVarStmt(std::shared_ptr<Var> stmt) override;
-    std::any visitFunctionStmt(std::shared_ptr<Function> function) override;
-    std::any visitVariableExpr(std::shared_ptr<Variable> expr) override;
-    std::any visitAssignExpr(std::shared_ptr<Assign> expr) override;
-    std::any visitExpressionStmt(std::shared_ptr<Expression> stmt) override;
-    std::any visitIfStmt(std::shared_ptr<If> stmt) override;
-    std::any visitPrintStmt(std::shared_ptr<Print> stmt) override;
-    std::any visitReturnStmt(std::shared_ptr<Return> stmt) override;
-    std::any visitWhileStmt(std::shared_ptr<While> stmt) override;
-    std::any visitBinaryExpr(std::shared_ptr<Binary> expr) override;
-    std::any visitCallExpr(std::shared_ptr<Call> expr) override;
-    std::any visitGroupingExpr(std::shared_ptr<Grouping> expr) override;
-    std::any visitLiteralExpr(std::shared_ptr<Literal> expr) override;
-    std::any visitLogicalExpr(std::shared_ptr<Logical> expr) override;
-    std::any visitUnaryExpr(std::shared_ptr<Unary> expr) override;
-    std::any visitClassStmt(std::shared_ptr<Class> stmt) override;
-    std::any visitGetExpr(std::shared_ptr<Get> expr) override;
-    std::any visitSetExpr(std::shared_ptr<Set> expr) override;
-    std::any visitThisExpr(std::shared_ptr<This> expr) override;
-    std::any visitSuperExpr(std::shared_ptr<Super> expr) override;
-    void resolve(std::vector<std::shared_ptr<Stmt>> statements);
+    void visitBlockStmt(Block& stmt) override;
+    void visitVarStmt(Var& stmt) override;
+    void visitFunctionStmt(Function& function) override;
+    LoxValue visitVariableExpr(Variable& expr) override;
+    LoxValue visitAssignExpr(Assign& expr) override;
+    void visitExpressionStmt(Expression& stmt) override;
+    void visitIfStmt(If& stmt) override;
+    void visitPrintStmt(Print& stmt) override;
+    void visitReturnStmt(Return& stmt) override;
+    void visitWhileStmt(While& stmt) override;
+    LoxValue visitBinaryExpr(Binary& expr) override;
+    LoxValue visitCallExpr(Call& expr) override;
+    LoxValue visitGroupingExpr(Grouping& expr) override;
+    LoxValue visitLiteralExpr(Literal& expr) override;
+    LoxValue visitLogicalExpr(Logical& expr) override;
+    LoxValue visitUnaryExpr(Unary& expr) override;
+    void visitClassStmt(Class& stmt) override;
+    LoxValue visitGetExpr(Get& expr) override;
+    LoxValue visitSetExpr(Set& expr) override;
+    LoxValue visitThisExpr(This& expr) override;
+    LoxValue visitSuperExpr(Super& expr) override;
+    void resolve(const std::vector<Stmt*>& statements);
+    // Frame slots the blocks of the top level need.
+    int scriptFrameSize() const { return frameSize; }
 
 private:
-    void resolve(std::shared_ptr<Stmt> stmt);
-    void resolve(std::shared_ptr<Expr> expr);
+    void resolve(Stmt* stmt);
+    void resolve(Expr* expr);
     void beginScope();
     void endScope();
-    void declare(Token& name);
+    int declare(Token& name);
+    int declare(const LoxString* name);
     void define(Token& name);
-    void resolveLocal(std::shared_ptr<Expr> expr, Token& name);
-    void resolveFunction(std::shared_ptr<Function> stmt, FunctionType type);
+    void bind(LocalSlot& local, const LoxString* name);
+    void resolveLocal(LocalSlot& local, const LoxString* name);
+    int resolveUpvalue(int function, int declaringFunction, int frameSlot);
+    int addUpvalue(Function* function, bool isLocal, int index);
+    void resolveFunction(Function* stmt, FunctionType type);
 };
 
 #endif // RESOLVER_HPP
\ No newline at end of file
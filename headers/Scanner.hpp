@@ -1,34 +1,55 @@
 #ifndef SCANNER_HPP
 #define SCANNER_HPP
 
-#include <string>
+#include <cstdint>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
+
+#include "Source.hpp"
 
 #include "TokenType.hpp"
 #include "Token.hpp"
+#include "TokenSource.hpp"
 
-class Scanner
+class Scanner : public TokenSource
 {
+public:
+    enum class LexicalError : uint32_t
+    {
+        UNEXPECTED_CHARACTER,
+        UNTERMINATED_STRING
+    };
+
 private:
-    std::string source;
+    std::string_view source;
+    uint32_t base;
     std::vector<Token> tokens;
     int start = 0;
     int current = 0;
-    int line = 1;
-    std::unordered_map<std::string, TokenType> keywords;
+    bool detached = false;
 
 public:
-    Scanner();
-    Scanner(std::string source);
+    Scanner(const Source& source);
+    // A detached scanner touches nothing it shares with the interpreter, so
+    // it can run on a thread of its own: identifiers and strings are left
+    // without literals, and lexical errors are returned as ERROR tokens whose
+    // literal is the LexicalError instead of being reported.
+    Scanner(const Source& source, bool detached);
+    // Each token with a literal holds it, and the caller must release it.
     std::vector<Token> scanTokens();
+    // Scans just far enough to return the next token, for a parser that
+    // pulls tokens as it needs them.
+    Token nextToken() override;
+    static const char* errorMessage(LexicalError error);
 
 private:
     bool isAtEnd();
     void scanToken();
     char advance();
-    void addToken(TokenType type);
-    void addToken(TokenType type, std::any literal);
+    void addToken(TokenType type, uint32_t literal = 0);
+    void addSymbol(TokenType type, std::string_view text);
+    void lexicalError(LexicalError error);
+    Token endOfFile();
     bool match(char expected);
     char peek();
     void _string();
@@ -38,7 +59,10 @@ private:
     bool isAlpha(char c);
     bool isAlphanumeric(char c);
     void identifier();
-    void initialiseKeywords();
+    void skipWhitespace();
+    void skipComment();
+    void skipStringContents();
+    void skipIdentifier();
 };
 
 #endif // SCANNER_HPP
\ No newline at end of file
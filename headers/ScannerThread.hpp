@@ -0,0 +1,51 @@
+#ifndef SCANNER_THREAD_HPP
+#define SCANNER_THREAD_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Scanner.hpp"
+#include "TokenSource.hpp"
+
+// Scans a source on a thread of its own, so that on a multi-core machine
+// lexing overlaps with parsing. The scanner thread hands its tokens over in
+// batches through a lock-free ring with one producer and one consumer. The
+// parser's thread interns the tokens' literals and reports lexical errors as
+// it takes them, since both touch state shared with the interpreter.
+class ScannerThread : public TokenSource
+{
+private:
+    // A power of two, so batch numbers map onto slots across overflow.
+    static constexpr size_t RING_SIZE = 8;
+    static constexpr size_t BATCH_SIZE = 1024;
+
+    Scanner scanner;
+    std::vector<Token> ring[RING_SIZE];
+    // Batches pushed and taken so far; batch n goes in slot n % RING_SIZE.
+    alignas(64) std::atomic<size_t> pushed {0};
+    alignas(64) std::atomic<size_t> taken {0};
+    std::atomic<bool> stopping {false};
+
+    // The consumer's side: the batch being read and the next token in it.
+    std::vector<Token> batch;
+    size_t next = 0;
+
+    std::thread thread;
+
+public:
+    explicit ScannerThread(const Source& source);
+    ~ScannerThread() override;
+    ScannerThread(const ScannerThread&) = delete;
+    ScannerThread& operator=(const ScannerThread&) = delete;
+
+    Token nextToken() override;
+
+private:
+    void produce();
+    void take();
+};
+
+#endif // SCANNER_THREAD_HPP
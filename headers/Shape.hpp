@@ -0,0 +1,75 @@
+#ifndef SHAPE_HPP
+#define SHAPE_HPP
+
+#include <memory>
+#include <unordered_map>
+#include "LoxString.hpp"
+
+// Hidden class describing the field layout of a LoxInstance: which field
+// names it has and at what offset each is stored. Instances that gained the
+// same fields in the same order share a Shape. Adding a field moves an
+// instance to a child shape; each class owns the tree of shapes rooted at
+// its empty shape.
+//
+// Offset tables are shared along a chain of shapes: a child appends its field
+// to its parent's table when the parent is the last shape to have extended
+// it, and an entry only belongs to the shapes whose fieldCount is past its
+// offset. Only a shape that branches off a chain copies the table, so adding
+// fields one at a time costs constant memory per shape.
+class Shape
+{
+public:
+    Shape* const parent;
+    const int fieldCount;
+
+private:
+    using Offsets = std::unordered_map<Ref<LoxString>, int>;
+
+    std::shared_ptr<Offsets> offsets;
+    std::unordered_map<Ref<LoxString>, std::unique_ptr<Shape>> transitions;
+
+public:
+    Shape() : parent {nullptr}, fieldCount {0}, offsets {std::make_shared<Offsets>()} {}
+    Shape(const Shape&) = delete;
+    Shape& operator=(const Shape&) = delete;
+
+    int find(const Ref<LoxString>& name) const
+    {
+        auto elem = offsets->find(name);
+        if(elem != offsets->end() && elem->second < fieldCount)
+        {
+            return elem->second;
+        }
+        return -1;
+    }
+
+    // The shape an instance of this shape moves to when it gains `name`.
+    Shape* addField(const Ref<LoxString>& name)
+    {
+        std::unique_ptr<Shape>& child = transitions[name];
+        if(child == nullptr)
+        {
+            child.reset(new Shape(this, name));
+        }
+        return child.get();
+    }
+
+private:
+    Shape(Shape* parent, const Ref<LoxString>& name) : parent {parent}, fieldCount {parent->fieldCount + 1}, offsets {parent->offsets}
+    {
+        if(offsets->size() != static_cast<size_t>(parent->fieldCount))
+        {
+            offsets = std::make_shared<Offsets>();
+            for(const auto& [field, offset] : *parent->offsets)
+            {
+                if(offset < parent->fieldCount)
+                {
+                    offsets->emplace(field, offset);
+                }
+            }
+        }
+        offsets->emplace(name, parent->fieldCount);
+    }
+};
+
+#endif // SHAPE_HPP
@@ -0,0 +1,55 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The text of one program. A script file is memory-mapped instead of read
+// into a string, so scanning it copies nothing: tokens, and the AST nodes
+// holding them, view their lexemes in place. The Source must therefore
+// outlive everything built from it.
+//
+// Every live Source is given a range of 32-bit offsets of its own, starting
+// at `base`; the range is free for another Source once it is destroyed. A
+// token records only its offset, and finds its Source, its lexeme and its
+// line from that.
+class Source
+{
+private:
+    std::string owned;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    std::string_view contents;
+    uint32_t base = 0;
+    // Offsets, within the text, at which lines after the first start. Built
+    // the first time a line number is asked for.
+    mutable std::vector<uint32_t> lineStarts;
+    mutable bool linesFound = false;
+
+public:
+    explicit Source(std::string text);
+    ~Source();
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+
+    // Null if the file cannot be opened.
+    static std::unique_ptr<Source> open(const std::string& path);
+
+    std::string_view text() const { return contents; }
+    uint32_t start() const { return base; }
+
+    // The live Source whose range holds `offset`.
+    static const Source& at(uint32_t offset);
+    std::string_view text(uint32_t offset, uint32_t length) const { return contents.substr(offset - base, length); }
+    int line(uint32_t offset) const;
+
+private:
+    Source() = default;
+    void registerRange();
+};
+
+#endif // SOURCE_HPP
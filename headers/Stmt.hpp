@@ -3,12 +3,12 @@
 #ifndef STMT_HPP
 #define STMT_HPP
 
-#include <any>
 #include <memory>
 #include <vector>
 #include <utility>
 #include <iostream>
 #include "Token.hpp"
+#include "Expr.hpp"
 
 class Block;
 class Expression;
@@ -20,146 +20,172 @@ class Function;
 class Return;
 class Class;
 
+// Where a closure finds an upvalue when it is created: `index` in the frame
+// of the enclosing call if `isLocal`, otherwise upvalue `index` of the
+// enclosing closure.
+struct UpvalueSlot
+{
+    bool isLocal;
+    int index;
+};
+
 class StmtVisitor
 {
 public:
-    virtual std::any visitBlockStmt(std::shared_ptr<Block> expr) = 0;
-    virtual std::any visitExpressionStmt(std::shared_ptr<Expression> expr) = 0;
-    virtual std::any visitPrintStmt(std::shared_ptr<Print> expr) = 0;
-    virtual std::any visitVarStmt(std::shared_ptr<Var> expr) = 0;
-    virtual std::any visitIfStmt(std::shared_ptr<If> expr) = 0;
-    virtual std::any visitWhileStmt(std::shared_ptr<While> expr) = 0;
-    virtual std::any visitFunctionStmt(std::shared_ptr<Function> expr) = 0;
-    virtual std::any visitReturnStmt(std::shared_ptr<Return> expr) = 0;
-    virtual std::any visitClassStmt(std::shared_ptr<Class> expr) = 0;
+    virtual void visitBlockStmt(Block& stmt) = 0;
+    virtual void visitExpressionStmt(Expression& stmt) = 0;
+    virtual void visitPrintStmt(Print& stmt) = 0;
+    virtual void visitVarStmt(Var& stmt) = 0;
+    virtual void visitIfStmt(If& stmt) = 0;
+    virtual void visitWhileStmt(While& stmt) = 0;
+    virtual void visitFunctionStmt(Function& stmt) = 0;
+    virtual void visitReturnStmt(Return& stmt) = 0;
+    virtual void visitClassStmt(Class& stmt) = 0;
     virtual ~StmtVisitor() = default;
 };
 
 class Stmt
 {
 public:
-    virtual std::any accept(StmtVisitor& visitor) = 0;
+    virtual void accept(StmtVisitor& visitor) = 0;
 };
 
-class Block : public Stmt, public std::enable_shared_from_this<Block>
+class Block : public Stmt
 {
 public:
-    std::vector<std::shared_ptr<Stmt>> statements;
+    std::vector<Stmt*> statements;
+    // Locals declared directly in this block, set by the Resolver. They use
+    // the frame slots from `frameSlot`.
+    int slotCount = 0;
+    int frameSlot = 0;
 public:
-    Block(std::vector<std::shared_ptr<Stmt>> statements) : statements(std::move(statements)) {}
-    std::any accept(StmtVisitor& visitor) override
+    Block(std::vector<Stmt*> statements) : statements(std::move(statements)) {}
+    void accept(StmtVisitor& visitor) override
     {
-        // std::cout << "In accept of block" << std::endl;
-        return visitor.visitBlockStmt(shared_from_this());
+        visitor.visitBlockStmt(*this);
     }
 };
 
-class Expression : public Stmt, public std::enable_shared_from_this<Expression>
+class Expression : public Stmt
 {
 public:
-    std::shared_ptr<Expr> expression;
+    Expr* expression;
 public:
-    Expression(std::shared_ptr<Expr> expression) : expression(expression) {}
-    std::any accept(StmtVisitor& visitor) override
+    Expression(Expr* expression) : expression(expression) {}
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitExpressionStmt(shared_from_this());
+        visitor.visitExpressionStmt(*this);
     }
 };
 
-class Print : public Stmt, public std::enable_shared_from_this<Print>
+class Print : public Stmt
 {
 public:
-    std::shared_ptr<Expr> expression;
+    Expr* expression;
 public:
-    Print(std::shared_ptr<Expr> expression) : expression(expression) {}
-    std::any accept(StmtVisitor& visitor) override
+    Print(Expr* expression) : expression(expression) {}
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitPrintStmt(shared_from_this());
+        visitor.visitPrintStmt(*this);
     }
 };
 
 
-class Var : public Stmt, public std::enable_shared_from_this<Var>
+class Var : public Stmt
 {
 public:
     Token name;
-    std::shared_ptr<Expr> initializer;
+    Expr* initializer;
+    LocalSlot local;
 public:
-    Var(Token name, std::shared_ptr<Expr> initializer) : name(name), initializer(initializer) {}
-    std::any accept(StmtVisitor& visitor) override
+    Var(Token name, Expr* initializer) : name(name), initializer(initializer) {}
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitVarStmt(shared_from_this());
+        visitor.visitVarStmt(*this);
     }
 };
 
-class If : public Stmt, public std::enable_shared_from_this<If>
+class If : public Stmt
 {
 public:
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> thenBranch;
-    std::shared_ptr<Stmt> elseBranch;
+    Expr* condition;
+    Stmt* thenBranch;
+    Stmt* elseBranch;
 public:
-    If(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> thenBranch, std::shared_ptr<Stmt> elseBranch) : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {}
-    std::any accept(StmtVisitor& visitor) override
+    If(Expr* condition, Stmt* thenBranch, Stmt* elseBranch) : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {}
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitIfStmt(shared_from_this());
+        visitor.visitIfStmt(*this);
     }
 };
 
-class While : public Stmt, public std::enable_shared_from_this<While>
+class While : public Stmt
 {
 public:
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> body;
+    Expr* condition;
+    Stmt* body;
 public:
-    While(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body) : condition {std::move(condition)}, body {std::move(body)} {}
-    std::any accept(StmtVisitor& visitor) override
+    While(Expr* condition, Stmt* body) : condition {std::move(condition)}, body {std::move(body)} {}
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitWhileStmt(shared_from_this());
+        visitor.visitWhileStmt(*this);
     }
 };
 
-class Function : public Stmt, public std::enable_shared_from_this<Function> 
+class Function : public Stmt 
 {
 public:
     Token name;
     std::vector<Token> params;
-    std::vector<std::shared_ptr<Stmt>> body;
-
-public:
-    Function(Token name, std::vector<Token> params, std::vector<std::shared_ptr<Stmt>> body) : name {std::move(name)}, params {std::move(params)}, body {std::move(body)} {};
-    std::any accept(StmtVisitor& visitor) override
+    std::vector<Stmt*> body;
+    LocalSlot local;
+    // Frame slots needed by the function and every block nested in it. The
+    // receiver of a method comes first, then the parameters.
+    int frameSize = 0;
+    // Receiver and parameter slots that inner functions capture, boxed on
+    // entry.
+    std::vector<int> boxedSlots;
+    // What a closure of this function captures, in upvalue order.
+    std::vector<UpvalueSlot> upvalues;
+    bool isMethod = false;
+
+public:
+    Function(Token name, std::vector<Token> params, std::vector<Stmt*> body) : name {std::move(name)}, params {std::move(params)}, body {std::move(body)} {};
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitFunctionStmt(shared_from_this());
+        visitor.visitFunctionStmt(*this);
     }
 };
 
-class Return : public Stmt, public std::enable_shared_from_this<Return> 
+class Return : public Stmt 
 {
 public:
     Token keyword;
-    std::shared_ptr<Expr> value;
+    Expr* value;
 
 public:
-    Return(Token keyword, std::shared_ptr<Expr> value) : keyword {std::move(keyword)}, value {std::move(value)} {};
-    std::any accept(StmtVisitor& visitor) override
+    Return(Token keyword, Expr* value) : keyword {std::move(keyword)}, value {std::move(value)} {};
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitReturnStmt(shared_from_this());
+        visitor.visitReturnStmt(*this);
     }
 };
 
-class Class : public Stmt, public std::enable_shared_from_this<Class>
+class Class : public Stmt
 {
 public:
     Token name;
-    std::shared_ptr<Variable> superclass;
-    std::vector<std::shared_ptr<Function>> methods;
+    Variable* superclass;
+    std::vector<Function*> methods;
+    LocalSlot local;
+    // Where the methods find "super", when there is a superclass.
+    LocalSlot superLocal;
 
 public:
-    Class(Token name, std::shared_ptr<Variable> superclass, std::vector<std::shared_ptr<Function>> methods) : name {std::move(name)}, superclass {std::move(superclass)}, methods {std::move(methods)} {}
-    std::any accept(StmtVisitor& visitor) override
+    Class(Token name, Variable* superclass, std::vector<Function*> methods) : name {std::move(name)}, superclass {std::move(superclass)}, methods {std::move(methods)} {}
+    void accept(StmtVisitor& visitor) override
     {
-        return visitor.visitClassStmt(shared_from_this());
+        visitor.visitClassStmt(*this);
     }
 };
 
@@ -2,26 +2,61 @@
 #define TOKEN_HPP
 
 #include "TokenType.hpp"
-#include <any>
+#include "LoxString.hpp"
+#include "Source.hpp"
+#include <cstdint>
+#include <deque>
 #include <string>
-#include <utility>
+#include <string_view>
+#include <vector>
 
-class Token
+// The strings tokens refer to, the names of identifiers and the values of
+// string literals, each stored once and found by index. Index 0 is no string.
+//
+// An entry lives as long as it has holds. Whatever produces a token with a
+// literal gives the token one hold, which passes to whoever takes the token:
+// the Parser hands it to the AstArena the token is parsed into, and the arena
+// gives it back when its nodes are destroyed. Freed indices are reused.
+class TokenLiterals
 {
 public:
-    const TokenType type;
-    const std::string lexeme;
-    const std::any literal;
-    const int line;
+    // Takes a hold on `string`'s entry, making one if it has none.
+    static uint32_t add(const Ref<LoxString>& string);
+    static void release(uint32_t index);
+    static const Ref<LoxString>& get(uint32_t index) { return entries()[index].string; }
 
-    Token() : type(TokenType(TokenType::EoF)), lexeme(""), literal(0), line(0) {}
+private:
+    friend class AstArena;
 
-    Token(TokenType type, std::string lexeme, std::any literal,
-          int line)
-        : type{type}, lexeme{std::move(lexeme)},
-          literal{std::move(literal)}, line{line}
+    struct Entry
     {
-    }
+        Ref<LoxString> string;
+        uint32_t holds = 0;
+        // The AstArena generation that last kept this entry.
+        uint64_t keeper = 0;
+    };
+
+    // A deque, so references handed out stay valid as entries are added.
+    static std::deque<Entry>& entries();
+    static std::vector<uint32_t>& freeIndices();
+};
+
+// A token is 16 bytes and trivially copyable: where its lexeme is in the
+// Source, and the index of its literal. Its lexeme and line are looked up
+// through the Source when needed, which is mostly when reporting errors.
+// Number literals are decoded by the parser from the lexeme.
+struct Token
+{
+    TokenType type = TokenType::EoF;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    uint32_t literal = 0;
+
+    std::string_view lexeme() const { return Source::at(offset).text(offset, length); }
+    // The line the token ends on, as jlox counts it.
+    int line() const { return Source::at(offset).line(offset + length); }
+    // The interned name of an identifier, or the value of a string literal.
+    const Ref<LoxString>& symbol() const { return TokenLiterals::get(literal); }
 
     std::string toString() const
     {
@@ -30,13 +65,11 @@ public:
         switch (type)
         {
         case TokenType::IDENTIFIER:
-            literal_text = lexeme;
+        case TokenType::NUMBER:
+            literal_text = lexeme();
             break;
         case TokenType::STRING:
-            literal_text = std::any_cast<std::string>(literal);
-            break;
-        case TokenType::NUMBER:
-            literal_text = std::to_string(std::any_cast<double>(literal));
+            literal_text = symbol()->toString();
             break;
         case (TokenType::TRUE):
             literal_text = "true";
@@ -48,8 +81,10 @@ public:
             literal_text = "nil";
         }
 
-        return ::TokenTypeToString(type) + " " + lexeme + " " + literal_text;
+        return ::TokenTypeToString(type) + " " + std::string(lexeme()) + " " + literal_text;
     }
 };
 
-#endif // TOKEN_HPP
\ No newline at end of file
+static_assert(sizeof(Token) == 16, "tokens should stay compact");
+
+#endif // TOKEN_HPP
@@ -0,0 +1,15 @@
+#ifndef TOKEN_SOURCE_HPP
+#define TOKEN_SOURCE_HPP
+
+#include "Token.hpp"
+
+// Where the parser pulls its tokens from, one at a time.
+class TokenSource
+{
+public:
+    virtual ~TokenSource() = default;
+    // Returns EoF from then on once the source is exhausted.
+    virtual Token nextToken() = 0;
+};
+
+#endif // TOKEN_SOURCE_HPP
@@ -17,7 +17,7 @@ enum class TokenType
     // Keywords.
     AND, CLASS, ELSE, FALSE, FUN, FOR, IF, NIL, OR, PRINT, RETURN, SUPER, THIS, TRUE, VAR, WHILE, BREAK,
 
-    EoF
+    ERROR, EoF
 };
 
 inline std::string TokenTypeToString(TokenType type)
@@ -63,6 +63,7 @@ inline std::string TokenTypeToString(TokenType type)
         case TokenType::VAR: return "VAR";
         case TokenType::WHILE: return "WHILE";
         case TokenType::BREAK: return "BREAK";
+        case TokenType::ERROR: return "ERROR";
         case TokenType::EoF: return "EoF";
     }
     return "Unknown TokenType";
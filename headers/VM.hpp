@@ -0,0 +1,84 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Chunk.hpp"
+#include "LoxString.hpp"
+#include "LoxValue.hpp"
+#include "VMObjects.hpp"
+
+// Stack-based bytecode virtual machine. Executes the script functions that
+// Compiler produces from the resolved AST. Global state persists across
+// calls to interpret() so the REPL can build on earlier lines.
+class VM
+{
+public:
+    static constexpr int FRAMES_MAX = 1024;
+    static constexpr int STACK_MAX = FRAMES_MAX * 256;
+
+private:
+    struct CallFrame
+    {
+        VMClosure* closure;
+        uint8_t* ip;
+        LoxValue* slots;
+    };
+
+    // Globals are resolved to indices by the Compiler, so access at runtime
+    // is an array load rather than a hash lookup.
+    struct Global
+    {
+        std::string name;
+        LoxValue value;
+        bool defined = false;
+    };
+
+    std::unique_ptr<LoxValue[]> stack;
+    LoxValue* stackTop;
+    std::vector<CallFrame> frames;
+    int frameCount = 0;
+    Ref<VMUpvalue> openUpvalues;
+
+    std::vector<Global> globals;
+    std::unordered_map<std::string, uint16_t> globalSlots;
+
+public:
+    VM();
+    void interpret(Ref<VMFunction> script);
+    int globalSlot(const std::string& name);
+
+private:
+    bool run();
+    void resetStack();
+    void runtimeError(const std::string& message);
+
+    void push(LoxValue value)
+    {
+        *stackTop++ = std::move(value);
+    }
+
+    LoxValue pop()
+    {
+        return std::move(*--stackTop);
+    }
+
+    LoxValue& peek(int distance)
+    {
+        return stackTop[-1 - distance];
+    }
+
+    bool call(VMClosure* closure, int argCount);
+    bool callValue(const LoxValue& callee, int argCount);
+    bool invoke(LoxString* name, int argCount);
+    bool invokeFromClass(VMClass* klass, LoxString* name, int argCount);
+    bool bindMethod(VMClass* klass, LoxString* name);
+    Ref<VMUpvalue> captureUpvalue(LoxValue* local);
+    void closeUpvalues(LoxValue* last);
+    void defineNative(const std::string& name, int arity, VMNative::NativeFn function);
+};
+
+#endif // VM_HPP
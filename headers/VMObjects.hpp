@@ -0,0 +1,194 @@
+#ifndef VMOBJECTS_HPP
+#define VMOBJECTS_HPP
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Chunk.hpp"
+#include "LoxObject.hpp"
+#include "LoxValue.hpp"
+#include "LoxString.hpp"
+
+// Runtime objects of the bytecode VM. They share LoxValue and LoxString with
+// the tree-walking Interpreter but have their own callable representation.
+
+class VMFunction : public LoxObject
+{
+public:
+    std::string name;
+    int arity = 0;
+    int upvalueCount = 0;
+    Chunk chunk;
+
+public:
+    VMFunction(std::string name) : LoxObject {ObjectType::VM_FUNCTION}, name {std::move(name)} {}
+    std::string toString() override
+    {
+        return name.empty() ? "<script>" : "<fn " + name + ">";
+    }
+};
+
+class VMNative : public LoxObject
+{
+public:
+    using NativeFn = LoxValue (*)(int argCount, LoxValue* args);
+
+    int arity;
+    NativeFn function;
+
+public:
+    VMNative(int arity, NativeFn function) : LoxObject {ObjectType::VM_NATIVE}, arity {arity}, function {function} {}
+    std::string toString() override
+    {
+        return "<native fn>";
+    }
+};
+
+// A variable captured by a closure. While the variable is still on the VM
+// stack `location` points at its stack slot; once the slot goes out of scope
+// the value is moved into `closed` and `location` points there instead.
+class VMUpvalue : public LoxObject
+{
+public:
+    LoxValue* location;
+    LoxValue closed;
+    Ref<VMUpvalue> next;
+
+public:
+    VMUpvalue(LoxValue* location) : LoxObject {ObjectType::VM_UPVALUE}, location {location} {}
+    std::string toString() override
+    {
+        return "upvalue";
+    }
+
+    // An open upvalue's variable is on the VM stack, which holds it already.
+    void trace(Tracer& tracer) override
+    {
+        tracer.visit(closed);
+        tracer.visit(next.get());
+    }
+
+    void clearReferences() override
+    {
+        closed = nullptr;
+        next = nullptr;
+    }
+};
+
+class VMClosure : public LoxObject
+{
+public:
+    Ref<VMFunction> function;
+    std::vector<Ref<VMUpvalue>> upvalues;
+
+public:
+    VMClosure(Ref<VMFunction> function) : LoxObject {ObjectType::VM_CLOSURE}, function {std::move(function)}
+    {
+        upvalues.resize(this->function->upvalueCount);
+    }
+    std::string toString() override
+    {
+        return function->toString();
+    }
+
+    void trace(Tracer& tracer) override
+    {
+        for(const Ref<VMUpvalue>& upvalue : upvalues)
+        {
+            tracer.visit(upvalue.get());
+        }
+    }
+
+    void clearReferences() override
+    {
+        upvalues.clear();
+    }
+};
+
+class VMClass : public LoxObject
+{
+public:
+    std::string name;
+    std::unordered_map<Ref<LoxString>, Ref<VMClosure>> methods;
+    Ref<VMClosure> initializer;
+
+public:
+    VMClass(std::string name) : LoxObject {ObjectType::VM_CLASS}, name {std::move(name)} {}
+    std::string toString() override
+    {
+        return name;
+    }
+
+    void trace(Tracer& tracer) override
+    {
+        for(auto& entry : methods)
+        {
+            tracer.visit(entry.second.get());
+        }
+        tracer.visit(initializer.get());
+    }
+
+    void clearReferences() override
+    {
+        methods.clear();
+        initializer = nullptr;
+    }
+};
+
+class VMInstance : public LoxObject
+{
+public:
+    Ref<VMClass> klass;
+    std::unordered_map<Ref<LoxString>, LoxValue> fields;
+
+public:
+    VMInstance(Ref<VMClass> klass) : LoxObject {ObjectType::VM_INSTANCE}, klass {std::move(klass)} {}
+    std::string toString() override
+    {
+        return klass->name + " instance";
+    }
+
+    void trace(Tracer& tracer) override
+    {
+        tracer.visit(klass.get());
+        for(auto& entry : fields)
+        {
+            tracer.visit(entry.second);
+        }
+    }
+
+    void clearReferences() override
+    {
+        klass = nullptr;
+        fields.clear();
+    }
+};
+
+class VMBoundMethod : public LoxObject
+{
+public:
+    LoxValue receiver;
+    Ref<VMClosure> method;
+
+public:
+    VMBoundMethod(LoxValue receiver, Ref<VMClosure> method) : LoxObject {ObjectType::VM_BOUND_METHOD}, receiver {std::move(receiver)}, method {std::move(method)} {}
+    std::string toString() override
+    {
+        return method->toString();
+    }
+
+    void trace(Tracer& tracer) override
+    {
+        tracer.visit(receiver);
+        tracer.visit(method.get());
+    }
+
+    void clearReferences() override
+    {
+        receiver = nullptr;
+        method = nullptr;
+    }
+};
+
+#endif // VMOBJECTS_HPP
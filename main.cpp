@@ -1,13 +1,45 @@
 #include <iostream>
+#include <string>
 #include "headers/Lox.hpp"
+#include "headers/Heap.hpp"
 
 int main(int argc, char** argv)
 {
-    TWI::Lox lox;
+    TWI::Backend backend = TWI::Backend::TREE_WALKER;
+    bool gcStats = false;
+    bool streaming = false;
+    bool scanThread = false;
+
+    for(; argc > 1 && argv[1][0] == '-' && argv[1][1] == '-'; argc--, argv++)
+    {
+        std::string flag = argv[1];
+        if(flag == "--vm")
+        {
+            backend = TWI::Backend::BYTECODE_VM;
+        }
+        else if(flag == "--stream")
+        {
+            streaming = true;
+        }
+        else if(flag == "--scan-thread")
+        {
+            scanThread = true;
+        }
+        else if(flag == "--gc-stats")
+        {
+            gcStats = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    TWI::Lox lox{backend, streaming, scanThread};
     
     if(argc > 2)
     {
-        std::cerr << "Usage: cppLox [script]" << std::endl;
+        std::cerr << "Usage: cppLox [--vm] [--stream] [--scan-thread] [--gc-stats] [script]" << std::endl;
         return 64;
     }
     else if(argc == 2)
@@ -18,5 +50,11 @@ int main(int argc, char** argv)
     {
         lox.runPrompt();
     }
+
+    if(gcStats)
+    {
+        const HeapStats& stats = Heap::stats();
+        std::cerr << "gc: " << stats.collections << " full and " << stats.minorCollections << " minor collections, " << stats.objectsPromoted << " objects promoted, " << stats.objectsFreed << " objects freed, " << stats.bytesFreed << " bytes freed, " << Heap::size() << " bytes in use" << std::endl;
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "../headers/Lox.hpp"
+#include "../headers/Heap.hpp"
+#include "../headers/Source.hpp"
 #include <fstream>
 
 const std::string TEST_FOLDER_PATH = "../../test/SampleLoxFiles";
@@ -20,24 +22,24 @@ std::string getExpectedOutput(std::string path)
     return expected_output;
 }
 
-std::string getActualOutput(std::string path)
+std::string getActualOutput(std::string path, TWI::Backend backend, bool streaming, bool scanThread)
 {
     std::string actual_output;
 
     // catch the output
     testing::internal::CaptureStdout();
-    TWI::Lox lox;
+    TWI::Lox lox{backend, streaming, scanThread};
     lox.runFile(path);
     actual_output = testing::internal::GetCapturedStdout();
 
     return actual_output;
 }
 
-void compare_output(std::string input_path, std::string expected_output_path)
+void compare_output(std::string input_path, std::string expected_output_path, TWI::Backend backend = TWI::Backend::TREE_WALKER, bool streaming = false, bool scanThread = false)
 {
     // compare the output
     std::string expected_output = getExpectedOutput(expected_output_path);
-    std::string actual_output = getActualOutput(input_path);
+    std::string actual_output = getActualOutput(input_path, backend, streaming, scanThread);
 
     EXPECT_EQ(expected_output, actual_output);
 }
@@ -46,4 +48,142 @@ TEST(InitialTest, Testing_Lox_1) {
     compare_output(TEST_FOLDER_PATH + "/test_1.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_1.lox.expected");
 }
 
+TEST(InitialTest, Testing_Lox_2) {
+    compare_output(TEST_FOLDER_PATH + "/test_2.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_2.lox.expected");
+}
+
+TEST(BytecodeVMTest, Testing_Lox_1) {
+    compare_output(TEST_FOLDER_PATH + "/test_1.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_1.lox.expected", TWI::Backend::BYTECODE_VM);
+}
+
+TEST(BytecodeVMTest, Testing_Lox_2) {
+    compare_output(TEST_FOLDER_PATH + "/test_2.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_2.lox.expected", TWI::Backend::BYTECODE_VM);
+}
+
+TEST(InitialTest, Testing_Lox_3) {
+    compare_output(TEST_FOLDER_PATH + "/test_3.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_3.lox.expected");
+}
+
+TEST(BytecodeVMTest, Testing_Lox_3) {
+    compare_output(TEST_FOLDER_PATH + "/test_3.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_3.lox.expected", TWI::Backend::BYTECODE_VM);
+}
+
+// Runs a program that fails to compile and compares what it reports. Uses
+// run() rather than runFile(), which exits on errors.
+void compare_errors(std::string input_path, std::string expected_output_path, TWI::Backend backend = TWI::Backend::TREE_WALKER, bool streaming = false, bool scanThread = false)
+{
+    std::string expected_output = getExpectedOutput(expected_output_path);
+
+    testing::internal::CaptureStderr();
+    TWI::Lox lox{backend, streaming, scanThread};
+    lox.run(getExpectedOutput(input_path));
+    std::string actual_output = testing::internal::GetCapturedStderr();
+
+    EXPECT_EQ(expected_output, actual_output);
+}
+
+TEST(GarbageCollectorTest, Testing_Lox_4) {
+    compare_output(TEST_FOLDER_PATH + "/test_4.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_4.lox.expected");
+
+    // Every Node refers to itself and every counter closure is stored in the
+    // variable it captured, so only the collector can free them.
+    size_t freedBefore = Heap::stats().objectsFreed;
+    Heap::collect();
+    EXPECT_GE(Heap::stats().objectsFreed - freedBefore, 2000u);
+}
+
+TEST(InitialTest, Testing_Lox_5) {
+    compare_output(TEST_FOLDER_PATH + "/test_5.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_5.lox.expected");
+}
+
+TEST(BytecodeVMTest, Testing_Lox_5) {
+    compare_output(TEST_FOLDER_PATH + "/test_5.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_5.lox.expected", TWI::Backend::BYTECODE_VM);
+}
+
+TEST(InitialTest, Testing_Lox_6) {
+    compare_output(TEST_FOLDER_PATH + "/test_6.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_6.lox.expected");
+}
+
+TEST(BytecodeVMTest, Testing_Lox_6) {
+    compare_output(TEST_FOLDER_PATH + "/test_6.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_6.lox.expected", TWI::Backend::BYTECODE_VM);
+}
+
+TEST(InitialTest, Testing_Lox_7) {
+    compare_output(TEST_FOLDER_PATH + "/test_7.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_7.lox.expected");
+}
+
+TEST(BytecodeVMTest, Testing_Lox_7) {
+    compare_output(TEST_FOLDER_PATH + "/test_7.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_7.lox.expected", TWI::Backend::BYTECODE_VM);
+}
+
+TEST(StreamingTest, Testing_Lox_3) {
+    compare_output(TEST_FOLDER_PATH + "/test_3.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_3.lox.expected", TWI::Backend::TREE_WALKER, true);
+}
+
+TEST(StreamingTest, Testing_Lox_6) {
+    compare_output(TEST_FOLDER_PATH + "/test_6.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_6.lox.expected", TWI::Backend::TREE_WALKER, true);
+}
+
+TEST(StreamingBytecodeVMTest, Testing_Lox_6) {
+    compare_output(TEST_FOLDER_PATH + "/test_6.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_6.lox.expected", TWI::Backend::BYTECODE_VM, true);
+}
+
+TEST(ScanThreadTest, Testing_Lox_3) {
+    compare_output(TEST_FOLDER_PATH + "/test_3.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_3.lox.expected", TWI::Backend::TREE_WALKER, false, true);
+}
+
+TEST(ScanThreadTest, Testing_Lox_6) {
+    compare_output(TEST_FOLDER_PATH + "/test_6.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_6.lox.expected", TWI::Backend::TREE_WALKER, true, true);
+}
+
+// Lexical errors are all reported before any syntax error.
+TEST(InitialTest, Testing_Lox_8) {
+    compare_errors(TEST_FOLDER_PATH + "/test_8.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_8.lox.expected");
+}
+
+TEST(ScanThreadTest, Testing_Lox_8) {
+    compare_errors(TEST_FOLDER_PATH + "/test_8.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_8.lox.expected", TWI::Backend::TREE_WALKER, false, true);
+}
 
+TEST(InitialTest, Testing_Lox_9) {
+    compare_errors(TEST_FOLDER_PATH + "/test_9.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_9.lox.expected");
+}
+
+// A streaming run reports the same errors, in the same order, as a batch run.
+TEST(StreamingTest, Testing_Lox_8) {
+    compare_errors(TEST_FOLDER_PATH + "/test_8.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_8.lox.expected", TWI::Backend::TREE_WALKER, true);
+}
+
+TEST(StreamingTest, Testing_Lox_9) {
+    compare_errors(TEST_FOLDER_PATH + "/test_9.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_9.lox.expected", TWI::Backend::TREE_WALKER, true);
+}
+
+TEST(StreamingBytecodeVMTest, Testing_Lox_9) {
+    compare_errors(TEST_FOLDER_PATH + "/test_9.lox", TEST_EXPECTED_OUTPUT_FOLDER_PATH + "/test_9.lox.expected", TWI::Backend::BYTECODE_VM, true);
+}
+
+TEST(StreamingTest, RuntimeErrorEndsOnlyItsRun) {
+    TWI::Lox lox{TWI::Backend::TREE_WALKER, true};
+    testing::internal::CaptureStderr();
+    lox.run("print nil + 1;");
+    testing::internal::GetCapturedStderr();
+
+    testing::internal::CaptureStdout();
+    lox.run("print 2;");
+    EXPECT_EQ("2\n", testing::internal::GetCapturedStdout());
+}
+
+// Offsets are 32 bits wide, so a long-running process must reuse the ranges
+// of sources it is done with.
+TEST(SourceTest, RangesOfDestroyedSourcesAreReused) {
+    Source kept{"print 1;"};
+    uint32_t start = 0;
+    for(int i = 0; i < 3; i++)
+    {
+        Source source{std::string(1 << 20, ' ')};
+        EXPECT_TRUE(i == 0 || source.start() == start);
+        start = source.start();
+        EXPECT_EQ(&Source::at(start + 10), &source);
+    }
+    EXPECT_EQ(&Source::at(kept.start()), &kept);
+}